@@ -0,0 +1,76 @@
+//! @cond
+#include "../src/quids.hpp"
+#include "../src/rules/quantum_computer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <map>
+
+int main(int argc, char* argv[]) {
+	const int max_num_qubit = argc > 1 ? std::atoi(argv[1]) : 20;
+	const int min_num_qubit = 8;
+	const int num_repeat = 3;
+
+	quids::tolerance = 1e-15;
+	quids::simple_truncation = true;
+
+	quids::sy_it_t sy_it;
+	quids::it_t state, buffer, output;
+
+	/* time spent in each phase of compute_collisions */
+	std::map<std::string, double> phase_time;
+	std::string phase = "";
+	auto phase_start = std::chrono::high_resolution_clock::now();
+	auto mid_step_function = [&](const char* step) {
+		auto now = std::chrono::high_resolution_clock::now();
+		if (phase.rfind("compute_collisions", 0) == 0)
+			phase_time[phase] += std::chrono::duration<double>(now - phase_start).count();
+
+		phase = step;
+		phase_start = now;
+	};
+
+	/* applying a hadamard a second time on the same qubit makes half of the symbolic objects collide */
+	quids::rules::quantum_computer::hadamard H0(0);
+	auto measure = [&](quids::it_t &input) {
+		std::cout << std::setw(12) << 2*input.num_object;
+
+		for (bool radix_sort : {false, true}) {
+			quids::radix_sort_collisions = radix_sort;
+
+			phase_time.clear();
+			for (int i = 0; i < num_repeat; ++i)
+				quids::simulate(input, H0, output, sy_it, 0, mid_step_function);
+
+			std::cout << std::setw(12) << phase_time["compute_collisions - prepare"]/num_repeat
+				<< std::setw(12) << phase_time["compute_collisions - insert"]/num_repeat
+				<< std::setw(12) << phase_time["compute_collisions - finalize"]/num_repeat;
+		}
+
+		std::cout << "\n";
+	};
+
+	std::cout << "compute_collisions time per phase (s), hashmap vs radix sort:\n";
+	std::cout << std::setw(12) << "symbolic"
+		<< std::setw(12) << "prepare" << std::setw(12) << "insert" << std::setw(12) << "finalize"
+		<< std::setw(12) << "prepare" << std::setw(12) << "sort" << std::setw(12) << "finalize" << "\n";
+
+	/* grow the state one qubit at a time, alternating between state and buffer */
+	std::vector<char> starting_state(max_num_qubit, 0);
+	state.append(&starting_state[0], &starting_state[0] + max_num_qubit);
+	for (int i = 1; i < max_num_qubit; i += 2) {
+		quids::rules::quantum_computer::hadamard H1(i), H2(i + 1);
+
+		quids::simulate(state, H1, buffer, sy_it);
+		if (i + 1 >= min_num_qubit)
+			measure(buffer);
+
+		if (i + 1 < max_num_qubit) {
+			quids::simulate(buffer, H2, state, sy_it);
+			if (i + 2 >= min_num_qubit)
+				measure(state);
+		}
+	}
+}
@@ -0,0 +1,59 @@
+//! @cond
+#include "../src/quids.hpp"
+#include "../src/rules/quantum_computer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <string>
+
+/* memory backed by transparent huge pages (in kB), as reported by the kernel */
+size_t get_anon_huge_pages() {
+	std::ifstream smaps("/proc/self/smaps_rollup");
+	std::string line;
+	while (std::getline(smaps, line))
+		if (line.rfind("AnonHugePages:", 0) == 0)
+			return std::stoul(line.substr(14));
+	return 0;
+}
+
+/* TLB misses can be measured by running this benchmark under "perf stat -e dTLB-load-misses,dTLB-store-misses" */
+int main(int argc, char* argv[]) {
+	const int num_qubit = 2*((argc > 1 ? std::atoi(argv[1]) : 22)/2);
+	const int num_repeat = 5;
+
+	quids::tolerance = 1e-15;
+
+	std::cout << "time per simulate (s) with a state of 2^" << num_qubit << " objects:\n";
+	std::cout << std::setw(24) << "huge_page_threshold" << std::setw(12) << "time" << std::setw(20) << "AnonHugePages (kB)" << "\n";
+
+	for (size_t huge_page_threshold : {(size_t)0, (size_t)1 << 21}) {
+		quids::utils::huge_page_threshold = huge_page_threshold;
+
+		/* new vectors, so that they are allocated with the current threshold */
+		quids::sy_it_t sy_it;
+		quids::it_t state, buffer;
+
+		/* apply a hadamard on each qubit, alternating between state and buffer */
+		std::vector<char> starting_state(num_qubit, 0);
+		state.append(&starting_state[0], &starting_state[0] + num_qubit);
+		for (int i = 0; i < num_qubit; i += 2) {
+			quids::rules::quantum_computer::hadamard H1(i), H2(i + 1);
+
+			quids::simulate(state, H1, buffer, sy_it);
+			quids::simulate(buffer, H2, state, sy_it);
+		}
+
+		/* applying a hadamard on the first qubit makes half of the symbolic objects collide, accessing objects in random order */
+		quids::rules::quantum_computer::hadamard H0(0);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < num_repeat; ++i) {
+			quids::simulate(state, H0, buffer, sy_it);
+			quids::simulate(buffer, H0, state, sy_it);
+		}
+		double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count()/(2*num_repeat);
+
+		std::cout << std::setw(24) << huge_page_threshold << std::setw(12) << time << std::setw(20) << get_anon_huge_pages() << "\n";
+	}
+}
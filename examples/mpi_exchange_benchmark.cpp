@@ -0,0 +1,79 @@
+//! @cond
+#define PROFILING
+#include "../src/quids_mpi.hpp"
+#include "../src/rules/qcgd.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+
+/* should be run with multiple (possibly oversubscribed) nodes, for example "mpirun --oversubscribe -n 4 ./mpi_exchange_benchmark.out" */
+int main(int argc, char* argv[]) {
+	const std::string starting_state = argc > 1 ? argv[1] : "6";
+	const int num_step = argc > 2 ? std::atoi(argv[2]) : 3;
+
+	int size, rank, provided;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+	if (provided < MPI_THREAD_SERIALIZED) {
+		printf("The threading support level is lesser than that demanded.\n");
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	quids::tolerance = 1e-15;
+
+	/* persistent context, so that the topology isn't recomputed at every step */
+	quids::mpi::context mpi_context(MPI_COMM_WORLD);
+
+	quids::rule_t *coin = new quids::rules::qcgd::erase_create(0.25, 0.25);
+	quids::rule_t *split_merge = new quids::rules::qcgd::split_merge(0.25, 0.25, 0.25);
+
+	if (rank == 0) {
+		std::cout << "exchange when computing collisions with " << size << " nodes, starting from \"" << starting_state << "\" for " << num_step << " steps:\n";
+		std::cout << std::setw(12) << "compress" << std::setw(12) << "quantize" << std::setw(16) << "bytes sent" << std::setw(12) << "time" << std::setw(12) << "com time" << std::setw(16) << "num object" << "\n";
+	}
+
+	for (auto [compress, quantize] : {std::pair{false, false}, std::pair{true, false}, std::pair{true, true}}) {
+		quids::mpi::compress_exchange = compress;
+		quids::mpi::quantize_magnitude = quantize;
+
+		quids::mpi::mpi_sy_it_t sy_it;
+		quids::mpi::mpi_it_t state, buffer;
+		quids::rules::qcgd::flags::read_n_iter("1,seed=0");
+		if (rank == 0)
+			quids::rules::qcgd::flags::read_state(starting_state.c_str(), state);
+
+		quids::utils::profiler profiler;
+		auto mid_step_function = profiler.mid_step_function();
+
+		MPI_Barrier(MPI_COMM_WORLD);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < num_step; ++i) {
+			quids::simulate(state, quids::rules::qcgd::step);
+			quids::mpi::simulate(state, coin, buffer, sy_it, mpi_context, 0, mid_step_function);
+			quids::mpi::simulate(buffer, split_merge, state, sy_it, mpi_context, 0, mid_step_function);
+		}
+		MPI_Barrier(MPI_COMM_WORLD);
+		double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		/* bytes sent (including to the node itself) and time spent waiting for communications when computing collisions */
+		size_t bytes = 0;
+		double com_time = 0;
+		for (auto const &iteration : profiler.iterations)
+			for (auto const &phase : iteration)
+				if (phase.name == "compute_collisions - com") {
+					bytes += phase.bytes;
+					com_time += phase.time;
+				}
+		MPI_Allreduce(MPI_IN_PLACE, &bytes, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+		MPI_Allreduce(MPI_IN_PLACE, &com_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+		size_t num_object = state.get_total_num_object(MPI_COMM_WORLD);
+		if (rank == 0)
+			std::cout << std::setw(12) << compress << std::setw(12) << quantize << std::setw(16) << bytes << std::setw(12) << time << std::setw(12) << com_time << std::setw(16) << num_object << "\n";
+	}
+
+	MPI_Finalize();
+}
@@ -0,0 +1,32 @@
+//! @cond
+#define PROFILING
+#include "../src/quids.hpp"
+#include "../src/rules/quantum_computer.hpp"
+
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+	const int num_qubit = argc > 1 ? std::atoi(argv[1]) : 16;
+
+	quids::tolerance = 1e-15;
+
+	quids::sy_it_t sy_it;
+	quids::it_t state, buffer;
+
+	quids::utils::profiler profiler;
+	auto mid_step_function = profiler.mid_step_function();
+
+	/* apply a hadamard on each qubit, and then a second time to make objects collide */
+	std::vector<char> starting_state(num_qubit, 0);
+	state.append(&starting_state[0], &starting_state[0] + num_qubit);
+	for (int i = 0; i < 2*num_qubit; i += 2) {
+		quids::rules::quantum_computer::hadamard H1(i%num_qubit), H2((i + 1)%num_qubit);
+
+		quids::simulate(state, H1, buffer, sy_it, 0, mid_step_function);
+		quids::simulate(buffer, H2, state, sy_it, 0, mid_step_function);
+	}
+
+	/* print the profiling data of the last iteration of each half */
+	profiler.iterations = {profiler.iterations[num_qubit - 1], profiler.iterations.back()};
+	std::cout << profiler.to_json();
+}
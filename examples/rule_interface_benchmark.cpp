@@ -0,0 +1,116 @@
+//! @cond
+#include "../src/quids.hpp"
+#include "../src/rules/quantum_computer.hpp"
+#include "../src/rules/qcgd.hpp"
+
+#include <iostream>
+#include <chrono>
+
+/* time a function, returning the elapsed time in seconds */
+template<class Function>
+double time_it(Function const &function) {
+	auto start = std::chrono::high_resolution_clock::now();
+	function();
+	auto stop = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(stop - start).count();
+}
+
+/* the bundled rules aren't final (so that they can be inherited from), so final classes are derived from them to allow inlining */
+class final_hadamard final : public quids::rules::quantum_computer::hadamard {
+	using quids::rules::quantum_computer::hadamard::hadamard;
+};
+class final_split_merge final : public quids::rules::qcgd::split_merge {
+	using quids::rules::qcgd::split_merge::split_merge;
+};
+
+int main(int argc, char* argv[]) {
+	const int num_qubit = 20;
+	const int num_qcgd_iter = 3;
+	const size_t max_num_object = 50000;
+
+	quids::align_byte_length = 0;
+	quids::tolerance = 1e-15;
+	quids::simple_truncation = true;
+
+	quids::sy_it_t sy_it;
+	quids::it_t state, buffer;
+
+	/* hadamard rules */
+	std::vector<final_hadamard> hadamards;
+	for (int i = 0; i < num_qubit; ++i)
+		hadamards.push_back(final_hadamard(i));
+
+	char starting_state[num_qubit] = {0};
+
+	/* hadamard through the rule_t vtable */
+	size_t hadamard_num_object = 0;
+	state.append(starting_state, starting_state + num_qubit);
+	double hadamard_virtual_time = time_it([&]() {
+		for (int i = 0; i < 2*num_qubit; i += 2) {
+			quids::rule_t *H1 = &hadamards[i%num_qubit], *H2 = &hadamards[(i + 1)%num_qubit];
+			quids::modifier_t X = quids::rules::quantum_computer::Xgate(i%num_qubit);
+
+			quids::simulate(state, H1, buffer, sy_it);
+			quids::simulate(buffer, X);
+			quids::simulate(buffer, H2, state, sy_it);
+
+			hadamard_num_object = std::max(hadamard_num_object, state.num_object);
+		}
+	});
+	state.pop(state.num_object, false);
+
+	/* hadamard through the templated interface */
+	state.append(starting_state, starting_state + num_qubit);
+	double hadamard_template_time = time_it([&]() {
+		for (int i = 0; i < 2*num_qubit; i += 2) {
+			auto const &H1 = hadamards[i%num_qubit], &H2 = hadamards[(i + 1)%num_qubit];
+			int const bit = i%num_qubit;
+
+			quids::simulate(state, H1, buffer, sy_it);
+			quids::simulate(buffer, [=](char *begin, char *end, quids::mag_t &mag) {
+				begin[bit] = !begin[bit];
+			});
+			quids::simulate(buffer, H2, state, sy_it);
+		}
+	});
+	state.pop(state.num_object, false);
+
+	std::cout << "hadamard (up to " << hadamard_num_object << " objects):\n";
+	std::cout << "\tvirtual: " << hadamard_virtual_time << "s\n";
+	std::cout << "\ttemplate: " << hadamard_template_time << "s\n";
+
+	/* split_merge rule */
+	final_split_merge split_merge(0.25, 0.25, 0.25);
+
+	/* split_merge through the rule_t vtable */
+	std::srand(0);
+	quids::rules::qcgd::flags::read_state("12,n_graphs=16", state);
+	double split_merge_virtual_time = time_it([&]() {
+		quids::rule_t *rule = &split_merge;
+		quids::modifier_t step = quids::rules::qcgd::step;
+		for (int i = 0; i < num_qcgd_iter; ++i) {
+			quids::simulate(state, step);
+			quids::simulate(state, rule, buffer, sy_it, max_num_object);
+			quids::simulate(buffer, step);
+			quids::simulate(buffer, rule, state, sy_it, max_num_object);
+		}
+	});
+	size_t split_merge_num_object = state.num_object;
+	state.pop(state.num_object, false);
+
+	/* split_merge through the templated interface */
+	std::srand(0);
+	quids::rules::qcgd::flags::read_state("12,n_graphs=16", state);
+	double split_merge_template_time = time_it([&]() {
+		for (int i = 0; i < num_qcgd_iter; ++i) {
+			quids::simulate(state, quids::rules::qcgd::step);
+			quids::simulate(state, split_merge, buffer, sy_it, max_num_object);
+			quids::simulate(buffer, quids::rules::qcgd::step);
+			quids::simulate(buffer, split_merge, state, sy_it, max_num_object);
+		}
+	});
+
+	std::cout << "split_merge (" << split_merge_num_object << " objects):\n";
+	std::cout << "\tvirtual: " << split_merge_virtual_time << "s\n";
+	std::cout << "\ttemplate: " << split_merge_template_time << "s\n";
+}
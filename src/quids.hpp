@@ -9,18 +9,29 @@ typedef unsigned uint;
 #include <complex>
 #include <cstddef>
 #include <vector>
+#include <array>
+#include <memory>
+#include <type_traits>
 
 #include "utils/libs/robin_hood.h"
 
 #include "utils/vector.hpp"
+#include "utils/arena.hpp"
 #include "utils/load_balancing.hpp"
 #include "utils/algorithm.hpp"
+#include "utils/kernels.hpp"
 #include "utils/memory.hpp"
 #include "utils/random.hpp"
+#include "utils/hash.hpp"
+#include "utils/collision_table.hpp"
+#include "utils/profiler.hpp"
 
 #ifndef PROBA_TYPE
 	#define PROBA_TYPE double /// typedefinition of probability type
 #endif
+#ifndef STORED_PROBA_TYPE
+	#define STORED_PROBA_TYPE PROBA_TYPE /// typedefinition of the type used to store magnitudes (computations are still done using PROBA_TYPE)
+#endif
 #ifndef HASH_MAP_OVERHEAD
 	#define HASH_MAP_OVERHEAD 1.7 /// overhead per 64-bit key and value insertion in hashmap (robinhood)
 #endif
@@ -39,9 +50,15 @@ typedef unsigned uint;
 #ifndef LOAD_BALANCING_BUCKET_PER_THREAD
 	#define LOAD_BALANCING_BUCKET_PER_THREAD 32
 #endif
+#ifndef MIN_SYMBOLIC_CHUNK_RATIO
+	#define MIN_SYMBOLIC_CHUNK_RATIO 0.1
+#endif
+#ifndef RANDOM_SEED
+	#define RANDOM_SEED 0
+#endif
 
-#define ITERATION_MEMORY_SIZE 2*sizeof(PROBA_TYPE) + 3*sizeof(size_t) + sizeof(float) + 2*sizeof(uint)
-#define SYMBOLIC_ITERATION_MEMORY_SIZE 2*sizeof(PROBA_TYPE) + 4*sizeof(size_t) + 2*sizeof(uint) + sizeof(float)
+#define ITERATION_MEMORY_SIZE 2*sizeof(STORED_PROBA_TYPE) + 4*sizeof(size_t) + sizeof(float) + 2*sizeof(uint)
+#define SYMBOLIC_ITERATION_MEMORY_SIZE 2*sizeof(STORED_PROBA_TYPE) + 4*sizeof(size_t) + 2*sizeof(uint) + sizeof(float)
 
 /*
 defining openmp function's return values if openmp isn't installed or loaded
@@ -66,6 +83,10 @@ namespace quids {
 	float equalize_factor = EQUALIZE_FACTOR;
 	/// number of load balancing buckets per thread
 	int load_balancing_bucket_per_thread = LOAD_BALANCING_BUCKET_PER_THREAD;
+	/// fraction of the memory budget reserved to generate a single chunk, when the symbolic iteration is generated by chunks
+	float min_symbolic_chunk_ratio = MIN_SYMBOLIC_CHUNK_RATIO;
+	/// seed of the random streams used for probabilistic truncation
+	uint64_t random_seed = RANDOM_SEED;
 	#ifdef SIMPLE_TRUNCATION
 		/// simple truncation toggle - disable probabilistic truncation, increasing "accuracy" but reducing the representability of truncation. Set true by the presence of the SIMPLE_TRUNCATION flag.
 		bool simple_truncation = true;
@@ -73,9 +94,34 @@ namespace quids {
 		/// simple truncation toggle - disable probabilistic truncation, increasing "accuracy" but reducing the representability of truncation. Set false (default) by the absence of the SIMPLE_TRUNCATION flag.
 		bool simple_truncation = false;
 	#endif
+	#ifdef RETAIN_SYMBOLIC_OBJECTS
+		/// retain toggle - keep the memory representation of symbolic objects generated in the symbolic step (if enough memory is available) rather than regenerating them when finalizing. Set true by the presence of the RETAIN_SYMBOLIC_OBJECTS flag.
+		bool retain_symbolic_objects = true;
+	#else
+		/// retain toggle - keep the memory representation of symbolic objects generated in the symbolic step (if enough memory is available) rather than regenerating them when finalizing. Set false (default) by the absence of the RETAIN_SYMBOLIC_OBJECTS flag.
+		bool retain_symbolic_objects = false;
+	#endif
+
+	#ifdef SYMBOLIC_CHUNKING
+		/// chunking toggle - generate the symbolic iteration by chunks of parents when it doesn't fit in memory, only keeping objects that survived interferences within each chunk. Set true by the presence of the SYMBOLIC_CHUNKING flag.
+		bool symbolic_chunking = true;
+	#else
+		/// chunking toggle - generate the symbolic iteration by chunks of parents when it doesn't fit in memory, only keeping objects that survived interferences within each chunk. Set false (default) by the absence of the SYMBOLIC_CHUNKING flag.
+		bool symbolic_chunking = false;
+	#endif
+
+	#ifdef RADIX_SORT_COLLISIONS
+		/// collision strategy toggle - eliminate duplicates by radix sorting hashes within each load-balancing bucket instead of inserting them into a hashmap. Set true by the presence of the RADIX_SORT_COLLISIONS flag.
+		bool radix_sort_collisions = true;
+	#else
+		/// collision strategy toggle - eliminate duplicates by radix sorting hashes within each load-balancing bucket instead of inserting them into a hashmap. Set false (default) by the absence of the RADIX_SORT_COLLISIONS flag.
+		bool radix_sort_collisions = false;
+	#endif
 
 	/// complex magnitude type
 	typedef std::complex<PROBA_TYPE> mag_t;
+	/// complex magnitude type used to store magnitudes
+	typedef std::complex<STORED_PROBA_TYPE> stored_mag_t;
 	/// iteration class type
 	typedef class iteration it_t;
 	/// symbolic iteration type
@@ -143,8 +189,53 @@ namespace quids {
 		virtual inline size_t hasher(char const *object_begin, char const *object_end) const {
 			return std::hash<std::string_view>()(std::string_view(object_begin, std::distance(object_begin, object_end)));
 		}
+		/// optional function telling if the hash of children can be deduced from the hash of their parent.
+		/**
+		 * If true, the hash of each parent is computed (using hasher) before generating its children, and passed to child_hasher and populate_children.
+		 */
+		virtual inline bool has_child_hasher() const { //can be overwritten
+			return false;
+		}
+		/// optional function computing the hash of a child from the hash of its parent.
+		/**
+		 * Base implementation simply hashes the child using hasher.
+		 * User can provide this function (and has_child_hasher) if the hash of a child can be computed by only looking at the difference with its parent (see utils::zobrist_key).
+		 * @param[in] parent_begin,parent_end delimitation of the parent object memory representation.
+		 * @param[in] parent_hash hash of the parent object (only valid if has_child_hasher returns true).
+		 * @param[in] child_begin,child_end delimitation of the child object memory representation.
+		 * @param[in] child_id children identifier among its siblings.
+		 */
+		virtual inline size_t child_hasher(char const *parent_begin, char const *parent_end, size_t const parent_hash, char const *child_begin, char const *child_end, uint const child_id) const { //can be overwritten
+			return hasher(child_begin, child_end);
+		}
+		/// optional function generating a range of siblings, and computing their magnitude, size and hash.
+		/**
+		 * Base implementation simply calls populate_child and child_hasher for each child.
+		 * User can provide this function to decode the parent only once for the whole range of siblings.
+		 * @param[in] parent_begin,parent_end delimitation of the parent object memory representation.
+		 * @param[in] parent_hash hash of the parent object (only valid if has_child_hasher returns true).
+		 * @param[out] child_begin placeholder memory in which each child is successively generated (before being hashed).
+		 * @param[in] first_child_id identifier of the first child to generate among its siblings.
+		 * @param[in] num_child number of consecutive children to generate.
+		 * @param[out] size children object memory representation sizes.
+		 * @param[out] mag magnitudes of the children objects (input should be the parent magnitude).
+		 * @param[out] hash hashes of the children objects.
+		 */
+		virtual inline void populate_children(char const *parent_begin, char const *parent_end, size_t const parent_hash, char* const child_begin, uint const first_child_id, uint const num_child, uint *size, mag_t *mag, size_t *hash) const { //can be overwritten
+			for (uint i = 0; i < num_child; ++i) {
+				populate_child(parent_begin, parent_end, child_begin, first_child_id + i,
+					size[i], mag[i]);
+				hash[i] = child_hasher(parent_begin, parent_end, parent_hash,
+					child_begin, child_begin + size[i], first_child_id + i);
+			}
+		}
 	};
 
+	template<class Rule>
+	void inline simulate(it_t &iteration, Rule const &rule, it_t &next_iteration, sy_it_t &symbolic_iteration, size_t max_num_object=0, debug_t mid_step_function=[](const char*){});
+	template<class Modifier>
+	void inline simulate(it_t &iteration, Modifier const &rule);
+
 	/// iteration (wave function) representation class
 	class iteration {
 	public:
@@ -152,6 +243,8 @@ namespace quids {
 		size_t num_object = 0;
 		/// total probability retained after previous truncation (if any).
 		PROBA_TYPE total_proba = 1;
+		/// number of dynamics applied to this wave function (used to key the random streams of probabilistic truncation).
+		size_t num_step = 0;
 
 		/// simple empty wavefunction constructor
 		iteration() {
@@ -186,6 +279,66 @@ namespace quids {
 			object_size[num_object - 1] = size;
 			object_begin[num_object] = offset + size + alignment_offset;
 		}
+		/// function that inserts a batch of objects in parallel, resizing the state only once
+		/**
+		 * @param[in] n number of objects to insert.
+		 * @param[in] object_size_ function taking the index (within the batch) of an object, and returning its size.
+		 * @param[in] populate_object function taking the index (within the batch) of an object, the begining of the memory to which it should be written (of size object_size_(i)), and a reference to its magnitude (initialized to 1).
+		 */
+		template<class SizeFunction, class PopulateFunction>
+		void append(size_t n, SizeFunction const &object_size_, PopulateFunction const &populate_object) {
+			if (n == 0)
+				return;
+
+			size_t const begin_num_object = num_object;
+			num_object += n;
+			resize(num_object);
+
+			/* compute object positions */
+			#pragma omp parallel for
+			for (size_t i = 0; i < n; ++i) {
+				uint size = object_size_(i);
+				object_size[begin_num_object + i] = size;
+				object_begin[begin_num_object + i + 1] = size + get_alignment_offset(size);
+			}
+
+			__gnu_parallel::partial_sum(&object_begin[begin_num_object],
+				&object_begin[num_object] + 1,
+				&object_begin[begin_num_object]);
+
+			allocate(object_begin[num_object]);
+
+			/* write objects */
+			#pragma omp parallel for
+			for (size_t i = 0; i < n; ++i) {
+				mag_t mag = 1;
+				populate_object(i, &objects[object_begin[begin_num_object + i]], mag);
+				magnitude[begin_num_object + i] = mag;
+			}
+		}
+		/// function that inserts a batch of objects stored contiguously, resizing the state only once
+		/**
+		 * @param[in] n number of objects to insert.
+		 * @param[in] object_sizes size of each object.
+		 * @param[in] objects_ begining of the objects, stored contiguously (without alignment).
+		 * @param[in] mags magnitude of each object (NULL gives a magnitude of 1 to each object).
+		 */
+		void append(size_t n, uint const *object_sizes, char const *objects_, mag_t const *mags) {
+			std::vector<size_t> offset(n + 1);
+			offset[0] = 0;
+			#pragma omp parallel for
+			for (size_t i = 0; i < n; ++i)
+				offset[i + 1] = object_sizes[i];
+			__gnu_parallel::partial_sum(offset.begin(), offset.end(), offset.begin());
+
+			append(n, [&](size_t i) {
+				return object_sizes[i];
+			}, [&](size_t i, char *object_begin_, mag_t &mag) {
+				std::copy(objects_ + offset[i], objects_ + offset[i + 1], object_begin_);
+				if (mags != NULL)
+					mag = mags[i];
+			});
+		}
 		/// function that removes a given number of object from the "tail" of the memory representation
 		/**
 		 * @param[in] n number of objects to remove
@@ -203,17 +356,30 @@ namespace quids {
 		}
 		/// function to get the average value of a custom observable
 		/**
+		 * The observable type is a template parameter, so that lambda-expressions can be inlined into the loop over objects (an observable_t is simply called through std::function).
 		 * @param[in] observable observable that should be computed.
 		 */
-		PROBA_TYPE average_value(const observable_t observable) const {
-			PROBA_TYPE avg = 0;
+		template<class Observable>
+		PROBA_TYPE average_value(Observable const &observable) const {
+			return average_values(observable)[0];
+		}
+		/// function to get the average values of multiple custom observables in a single pass over the wave function
+		/**
+		 * @param[in] observables observables that should be computed.
+		 * @return average value of each observable, in the same order as observables.
+		 */
+		template<class... Observables>
+		std::array<PROBA_TYPE, sizeof...(Observables)> average_values(Observables const &...observables) const {
+			std::array<PROBA_TYPE, sizeof...(Observables)> avg;
+			avg.fill(0);
 			if (num_object == 0)
 				return avg;
 
 			#pragma omp parallel
 			{	
-				/* compute average per thread */
-				PROBA_TYPE local_avg = 0;
+				/* compute averages per thread */
+				std::array<PROBA_TYPE, sizeof...(Observables)> local_avg;
+				local_avg.fill(0);
 				#pragma omp for 
 				for (size_t oid = 0; oid < num_object; ++oid) {
 					uint size;
@@ -222,12 +388,16 @@ namespace quids {
 					/* get object and accumulate */
 					char const *this_object_begin;
 					get_object(oid, this_object_begin, size, mag);
-					local_avg += observable(this_object_begin, this_object_begin + size) * std::norm(mag);
+					PROBA_TYPE proba = std::norm(mag);
+
+					size_t i = 0;
+					((local_avg[i++] += observables(this_object_begin, this_object_begin + size) * proba), ...);
 				}
 
 				/* accumulate thread averages */
 				#pragma omp critical
-				avg += local_avg;
+				for (size_t i = 0; i < sizeof...(Observables); ++i)
+					avg[i] += local_avg[i];
 			}
 
 			return avg;
@@ -239,7 +409,7 @@ namespace quids {
 		 * @param[out] object_size size of the memory representation of the object.
 		 * @param[out] mag magnitude of the object.
 		 */
-		void get_object(size_t const object_id, char *& object_begin_, uint &object_size_, mag_t *&mag) {
+		void get_object(size_t const object_id, char *& object_begin_, uint &object_size_, stored_mag_t *&mag) {
 			object_size_ = object_size[object_id];
 			mag = &magnitude[object_id];
 			object_begin_ = &objects[object_begin[object_id]];
@@ -256,17 +426,41 @@ namespace quids {
 			mag = magnitude[object_id];
 			object_begin_ = &objects[object_begin[object_id]];
 		}
+		/// function to back the wave function by memory-mapped files (created in utils::mmap_directory) rather than by the heap
+		/**
+		 * A file-backed wave function doesn't count against the available memory when simulating, but against the free disk space.
+		 * @param[in] file_backed wether to use memory-mapped files (true) or the heap (false).
+		 */
+		void set_file_backed(bool file_backed=true) {
+			magnitude.set_file_backed(file_backed);
+			objects.set_file_backed(file_backed);
+			object_begin.set_file_backed(file_backed);
+			object_size.set_file_backed(file_backed);
+			num_childs.set_file_backed(file_backed);
+			child_begin.set_file_backed(file_backed);
+			truncated_oid.set_file_backed(file_backed);
+			random_selector.set_file_backed(file_backed);
+			object_hash.set_file_backed(file_backed);
+		}
+		/// function telling if the wave function is backed by memory-mapped files
+		bool is_file_backed() const {
+			return objects.is_file_backed();
+		}
 
 	private:
 		friend symbolic_iteration;
-		friend void inline simulate(it_t &iteration, rule_t const *rule, it_t &next_iteration, sy_it_t &symbolic_iteration, size_t max_num_object, debug_t mid_step_function);  
-		friend void inline simulate(it_t &iteration, modifier_t const rule);
+		template<class Rule>
+		friend void inline simulate(it_t &iteration, Rule const &rule, it_t &next_iteration, sy_it_t &symbolic_iteration, size_t max_num_object, debug_t mid_step_function);
+		template<class Modifier>
+		friend void inline simulate(it_t &iteration, Modifier const &rule);
 
 	protected:
 		mutable size_t truncated_num_object = 0;
 		mutable uint ub_symbolic_object_size = 0;
+		/* maximum number of symbolic objects generated at once (0 means the whole symbolic iteration is generated at once) */
+		mutable size_t symbolic_chunk_size = 0;
 
-		mutable utils::fast_vector<mag_t> magnitude;
+		mutable utils::fast_vector<stored_mag_t> magnitude;
 		mutable utils::fast_vector<char> objects;
 		mutable utils::fast_vector<size_t> object_begin;
 		mutable utils::fast_vector<uint> object_size;
@@ -274,10 +468,12 @@ namespace quids {
 		mutable utils::fast_vector<size_t> child_begin;
 		mutable utils::fast_vector<size_t> truncated_oid;
 		mutable utils::fast_vector<float> random_selector;
+		mutable utils::fast_vector<size_t> object_hash;
 
 		//! @cond
 		void inline resize(size_t num_object) const {
-			#pragma omp parallel sections
+			/* resize sequentially when first-touching pages, so that each vector is touched by all threads */
+			#pragma omp parallel sections if(!utils::numa_first_touch)
 			{
 				#pragma omp section
 				magnitude.resize(num_object);
@@ -302,11 +498,31 @@ namespace quids {
 
 				#pragma omp section
 				random_selector.resize(num_object);
+
+				#pragma omp section
+				object_hash.resize(num_object);
 			}
 		}
 		void inline allocate(size_t size) const {
 			objects.resize(size, align_byte_length);
 		}
+		void inline shrink_to_fit() const {
+			magnitude.shrink_to_fit();
+			num_childs.shrink_to_fit();
+			object_size.shrink_to_fit();
+			object_begin.shrink_to_fit();
+			child_begin.shrink_to_fit();
+			truncated_oid.shrink_to_fit();
+			random_selector.shrink_to_fit();
+			object_hash.shrink_to_fit();
+			objects.shrink_to_fit(align_byte_length);
+		}
+		void inline advise(int advice) const {
+			magnitude.advise(advice);
+			objects.advise(advice);
+			object_begin.advise(advice);
+			object_size.advise(advice);
+		}
 
 
 		/*
@@ -314,6 +530,9 @@ namespace quids {
 		*/
 		size_t get_mem_size() const {
 			static const size_t iteration_memory_size = ITERATION_MEMORY_SIZE;
+			if (is_file_backed())
+				return 0;
+
 			return (magnitude.size()*iteration_memory_size + objects.size())*utils::upsize_policy;
 		}
 		size_t get_object_length() const {
@@ -322,14 +541,40 @@ namespace quids {
 		size_t get_num_symbolic_object() const {
 			return __gnu_parallel::accumulate(&num_childs[0], &num_childs[0] + num_object, (size_t)0);
 		}
+		size_t get_symbolic_chunk_end(size_t begin_num_object) const {
+			if (symbolic_chunk_size == 0)
+				return truncated_num_object;
+
+			/* add parents until the chunk is full (with at least one parent per chunk) */
+			size_t end_num_object = begin_num_object, chunk_num_child = 0;
+			while (end_num_object < truncated_num_object) {
+				chunk_num_child += num_childs[truncated_oid[end_num_object]];
+				if (chunk_num_child > symbolic_chunk_size && end_num_object > begin_num_object)
+					break;
+				++end_num_object;
+			}
 
+			return end_num_object;
+		}
 
-		void compute_num_child(rule_t const *rule, debug_t mid_step_function=[](const char*){}) const;
+
+		template<class Rule>
+		void compute_num_child(Rule const &rule, debug_t mid_step_function=[](const char*){}) const;
 		void prepare_truncate(debug_t mid_step_function=[](const char*){}) const;
-		size_t get_truncated_mem_size(size_t begin_num_object=0) const;
+		size_t get_object_mem_size(size_t oid, float symbolic_ratio=1) const;
+		size_t get_truncated_mem_size(size_t begin_num_object=0, size_t end_num_object=-1, float symbolic_ratio=1) const;
 		void truncate(size_t begin_num_object, size_t max_num_object, debug_t mid_step_function=[](const char*){}) const;
-		void generate_symbolic_iteration(rule_t const *rule, sy_it_t &symbolic_iteration, debug_t mid_step_function=[](const char*){}) const;
-		void apply_modifier(modifier_t const rule);
+		template<class memSizeFunctionType>
+		void truncate_mem_size(size_t begin_num_object, size_t max_mem_size, memSizeFunctionType const object_mem_size, debug_t mid_step_function=[](const char*){}) const;
+		void truncate_mem_size(size_t max_mem_size, debug_t mid_step_function=[](const char*){}) const {
+			truncate_mem_size(0, max_mem_size, [&](size_t const oid) {
+				return get_object_mem_size(oid);
+			}, mid_step_function);
+		}
+		template<class Rule>
+		void generate_symbolic_iteration(Rule const &rule, sy_it_t &symbolic_iteration, size_t begin_num_object, size_t end_num_object, debug_t mid_step_function=[](const char*){}) const;
+		template<class Modifier>
+		void apply_modifier(Modifier const &rule);
 		void normalize(debug_t mid_step_function=[](const char*){});
 		//! @endcond
 	};
@@ -345,16 +590,44 @@ namespace quids {
 		/// number of objects obrained after eliminating duplicates
 		size_t num_object_after_interferences = 0;
 
+		/// function to back the symbolic iteration by memory-mapped files (created in utils::mmap_directory) rather than by the heap
+		/**
+		 * A file-backed symbolic iteration doesn't count against the available memory when simulating, but against the free disk space.
+		 * @param[in] file_backed wether to use memory-mapped files (true) or the heap (false).
+		 */
+		void set_file_backed(bool file_backed=true) {
+			magnitude.set_file_backed(file_backed);
+			next_oid.set_file_backed(file_backed);
+			size.set_file_backed(file_backed);
+			hash.set_file_backed(file_backed);
+			parent_oid.set_file_backed(file_backed);
+			child_id.set_file_backed(file_backed);
+			random_selector.set_file_backed(file_backed);
+			next_oid_partitioner_buffer.set_file_backed(file_backed);
+			retained_begin.set_file_backed(file_backed);
+		}
+		/// function telling if the symbolic iteration is backed by memory-mapped files
+		bool is_file_backed() const {
+			return magnitude.is_file_backed();
+		}
+
 	private:
 		friend iteration;
-		friend void inline simulate(it_t &iteration, rule_t const *rule, it_t &next_iteration, sy_it_t &symbolic_iteration, size_t max_num_object, debug_t mid_step_function); 
+		template<class Rule>
+		friend void inline simulate(it_t &iteration, Rule const &rule, it_t &next_iteration, sy_it_t &symbolic_iteration, size_t max_num_object, debug_t mid_step_function);
 
 	protected:
 		size_t next_iteration_num_object = 0;
+		size_t num_spilled_object = 0;
+		bool retain_objects = false;
 
-		std::vector<char*> placeholder;
+		/* per-thread scratch memory (used as placeholder for generated objects), kept accross iterations */
+		utils::scratch_arena scratch;
+		std::vector<size_t> staging_begin;
+		std::vector<std::unique_ptr<utils::fast_vector<char>>> staging;
+		std::vector<std::unique_ptr<utils::collision_table<size_t>>> collision_tables;
 
-		utils::fast_vector<mag_t> magnitude;
+		utils::fast_vector<stored_mag_t> magnitude;
 		utils::fast_vector<size_t> next_oid;
 		utils::fast_vector<uint> size;
 		utils::fast_vector<size_t> hash;
@@ -362,10 +635,12 @@ namespace quids {
 		utils::fast_vector<uint> child_id;
 		utils::fast_vector<float> random_selector;
 		utils::fast_vector<size_t> next_oid_partitioner_buffer;
+		utils::fast_vector<size_t> retained_begin;
 
 		//! @cond
 		void inline resize(size_t num_object) {
-			#pragma omp parallel sections
+			/* resize sequentially when first-touching pages, so that each vector is touched by all threads */
+			#pragma omp parallel sections if(!utils::numa_first_touch)
 			{
 				#pragma omp section
 				magnitude.resize(num_object);
@@ -390,25 +665,25 @@ namespace quids {
 
 				#pragma omp section
 				next_oid_partitioner_buffer.resize(num_object);
+
+				#pragma omp section
+				if (retain_objects)
+					retained_begin.resize(num_object);
 			}
 
 			utils::parallel_iota(&next_oid[0], &next_oid[num_object], 0);
 		}
-		void inline reserve(size_t max_size) {
-			int num_threads;
-			#pragma omp parallel
-			#pragma omp single
-			num_threads = omp_get_num_threads();
-
-			placeholder.resize(num_threads);
+		void inline reserve_staging(int num_threads) {
+			for (int i = staging.size(); i < num_threads; ++i)
+				staging.push_back(std::make_unique<utils::fast_vector<char>>());
 
-			#pragma omp parallel
-			{
-				auto &buffer = placeholder[omp_get_thread_num()];
-				if (buffer == NULL)
-					free(buffer);
-				buffer = new char[max_size];
-			}
+			staging_begin.resize(num_threads + 1);
+			for (int i = 0; i <= num_threads; ++i)
+				staging_begin[i] = num_object*i/num_threads;
+		}
+		void inline reserve_collision_tables(int num_threads) {
+			for (int i = collision_tables.size(); i < num_threads; ++i)
+				collision_tables.push_back(std::make_unique<utils::collision_table<size_t>>());
 		}
 
 
@@ -417,27 +692,62 @@ namespace quids {
 		*/
 		size_t get_mem_size() const {
 			static const size_t symbolic_iteration_memory_size = SYMBOLIC_ITERATION_MEMORY_SIZE;
-			return magnitude.size()*symbolic_iteration_memory_size*utils::upsize_policy;
+			if (is_file_backed())
+				return get_staging_mem_size()*utils::upsize_policy + scratch.mem_size();
+
+			return (magnitude.size()*symbolic_iteration_memory_size + get_staging_mem_size())*utils::upsize_policy + scratch.mem_size();
+		}
+		size_t get_staging_mem_size() const {
+			if (!retain_objects)
+				return 0;
+
+			size_t mem_size = retained_begin.size()*sizeof(size_t);
+			for (auto const &buffer : staging)
+				mem_size += buffer->size();
+			return mem_size;
 		}
 
-		void compute_collisions(debug_t mid_step_function=[](const char*){});
+		void compute_collisions(size_t begin_num_object, debug_t mid_step_function=[](const char*){});
+		void eliminate_duplicates(size_t begin_num_object, debug_t mid_step_function=[](const char*){});
+		void spill(debug_t mid_step_function=[](const char*){});
+		template<typename T>
+		void gather_spilled(T *array);
+		size_t get_object_mem_size(size_t oid) const;
 		size_t get_truncated_mem_size(size_t begin_num_object=0) const;
 		void truncate(size_t begin_num_object, size_t max_num_object, debug_t mid_step_function=[](const char*){});
-		void prepare_truncate(debug_t mid_step_function=[](const char*){});
-		void finalize(rule_t const *rule, it_t const &last_iteration, it_t &next_iteration, debug_t mid_step_function=[](const char*){});
+		void truncate_mem_size(size_t max_mem_size, debug_t mid_step_function=[](const char*){});
+		void prepare_truncate(size_t num_step, debug_t mid_step_function=[](const char*){});
+		template<class Rule>
+		void finalize(Rule const &rule, it_t const &last_iteration, it_t &next_iteration, debug_t mid_step_function=[](const char*){});
 		//! @endcond
 	};
 
 	/// function to apply a modifer to a wave function
 	/**
+	 * The modifier type is a template parameter, so that lambda-expressions and functions can be inlined into the loop over objects (a modifier_t is simply called through std::function).
 	 * @param[in] iteration wavefunction that the modifier will be applied to.
 	 * @param[in] rule modifer that will be applied
 	 */
-	void inline simulate(it_t &iteration, modifier_t const rule) {
+	template<class Modifier>
+	void inline simulate(it_t &iteration, Modifier const &rule) {
 		iteration.apply_modifier(rule);
 	}
 	/// function to apply a dynamic to a wavefunction
 	/**
+	 * @param[in] iteration wavefunction that the dynamic will be applied to.
+	 * @param[in] rule pointer to the dynamic that will be applied (member functions are called through the rule_t vtable if the pointer is of type rule_t*).
+	 * @param[out] next_iteration wave function that will be overwritten to then contained the final wave function.
+	 * @param[out] symbolic_iteration symbolic iteration that will be used.
+	 * @param[in] max_num_object maximum number of objects to be kept, -1 means no maximum, 0 means automaticaly finding the maximum ammount of objects that can be kept in memory.
+	 * @param[in] mid_step_function debuging function called between steps.
+	 */
+	template<class Rule>
+	void inline simulate(it_t &iteration, Rule *rule, it_t &next_iteration, sy_it_t &symbolic_iteration, size_t max_num_object=0, debug_t mid_step_function=[](const char*){}) {
+		simulate(iteration, *rule, next_iteration, symbolic_iteration, max_num_object, mid_step_function);
+	}
+	/// function to apply a dynamic to a wavefunction
+	/**
+	 * The rule type is a template parameter, so that member functions of a rule declared "final" (or of a class that doesn't inherit from rule_t at all) can be inlined into the loops over objects.
 	 * @param[in] iteration wavefunction that the dynamic will be applied to.
 	 * @param[in] rule dynamic that will be applied.
 	 * @param[out] next_iteration wave function that will be overwritten to then contained the final wave function.
@@ -445,7 +755,8 @@ namespace quids {
 	 * @param[in] max_num_object maximum number of objects to be kept, -1 means no maximum, 0 means automaticaly finding the maximum ammount of objects that can be kept in memory.
 	 * @param[in] mid_step_function debuging function called between steps.
 	 */
-	void inline simulate(it_t &iteration, rule_t const *rule, it_t &next_iteration, sy_it_t &symbolic_iteration, size_t max_num_object=0, debug_t mid_step_function=[](const char*){}) {	
+	template<class Rule>
+	void inline simulate(it_t &iteration, Rule const &rule, it_t &next_iteration, sy_it_t &symbolic_iteration, size_t max_num_object, debug_t mid_step_function) {
 		/* compute the number of child */
 		iteration.compute_num_child(rule, mid_step_function);
 		iteration.truncated_num_object = iteration.num_object;
@@ -456,6 +767,9 @@ namespace quids {
 
 		/* max_num_object */
 		mid_step_function("truncate_symbolic");
+		iteration.symbolic_chunk_size = 0;
+		size_t const symbolic_object_mem_size = (SYMBOLIC_ITERATION_MEMORY_SIZE + HASH_MAP_OVERHEAD*2*sizeof(size_t))*utils::upsize_policy;
+		size_t symbolic_target_memory = 0, symbolic_chunk_memory = 0;
 		if (max_num_object == 0) {
 
 			/* available memory */
@@ -465,26 +779,26 @@ namespace quids {
 				next_iteration_mem = (1 - equalize_factor)*next_iteration_mem + equalize_factor*previous_iteration_mem;
 			}
 			size_t avail_memory = next_iteration_mem + symbolic_iteration.get_mem_size() + quids::utils::get_free_mem();
+			if (symbolic_iteration.is_file_backed() || next_iteration.is_file_backed())
+				avail_memory += quids::utils::get_free_disk_space();
 			size_t non_avail_memory = previous_iteration_mem;
 			size_t target_memory = (avail_memory + non_avail_memory)*(1 - quids::safety_margin) - non_avail_memory;
 
-			/* actually truncate by binary search */
+			/* actually truncate */
 			if (iteration.get_truncated_mem_size() > target_memory) {
-				size_t begin = 0, end = iteration.num_object;
-				while (end > begin + 1) {
-					size_t middle = (end + begin) / 2;
-					iteration.truncate(begin, middle, mid_step_function);
-
-					size_t used_memory = iteration.get_truncated_mem_size(begin);
-					if (used_memory < target_memory) {
-						target_memory -= used_memory;
-						begin = middle;
-					} else
-						end = middle;
+				/* parents are first selected as if all of their children were kept, the selection is then revised after each chunk (see below) */
+				iteration.truncate_mem_size(target_memory, mid_step_function);
+
+				/* generate the symbolic iteration by chunks, each using min_symbolic_chunk_ratio of the budget */
+				if (symbolic_chunking) {
+					symbolic_target_memory = target_memory;
+					symbolic_chunk_memory = target_memory*min_symbolic_chunk_ratio;
+					iteration.symbolic_chunk_size = std::max((size_t)1, symbolic_chunk_memory/symbolic_object_mem_size);
 				}
 			}
 		} else
 			iteration.truncate(0, max_num_object, mid_step_function);
+		PROFILE_OBJECTS(iteration.num_object, iteration.truncated_num_object);
 
 		/* downsize if needed */
 		if (iteration.num_object > 0) {
@@ -493,17 +807,58 @@ namespace quids {
 			size_t next_object_size = iteration.truncated_num_object*iteration.get_object_length()/iteration.num_object;
 			if (next_object_size < next_iteration.objects.size())
 				next_iteration.allocate(next_object_size);
+
+			/* actually free the memory of next_iteration that was counted as available when truncating */
+			if (iteration.truncated_num_object < iteration.num_object)
+				next_iteration.shrink_to_fit();
 		}
 
 		/* generate symbolic iteration */
-		iteration.generate_symbolic_iteration(rule, symbolic_iteration, mid_step_function);
-		symbolic_iteration.compute_collisions(mid_step_function);
+		size_t chunk_end = iteration.get_symbolic_chunk_end(0);
+		if (chunk_end == iteration.truncated_num_object) {
+			iteration.generate_symbolic_iteration(rule, symbolic_iteration, 0, chunk_end, mid_step_function);
+			symbolic_iteration.compute_collisions(0, mid_step_function);
+		} else {
+			/* generate the symbolic iteration by chunks of parents, only keeping objects that survived interferences within each chunk */
+			size_t chunk_begin = 0, num_generated_object = 0;
+			size_t const first_chunk_end = chunk_end;
+			while (chunk_begin < iteration.truncated_num_object) {
+				iteration.generate_symbolic_iteration(rule, symbolic_iteration, chunk_begin, chunk_end, mid_step_function);
+				num_generated_object += symbolic_iteration.num_object - symbolic_iteration.num_spilled_object;
+				symbolic_iteration.compute_collisions(symbolic_iteration.num_spilled_object, mid_step_function);
+				symbolic_iteration.spill(mid_step_function);
+				chunk_begin = chunk_end;
+
+				/* memory used by the parents that were already generated and by spilled objects, the remaining parents being charged for
+				the fraction of their children expected to survive interferences within their chunk (as measured since the begining of this step) */
+				float const survivor_ratio = num_generated_object == 0 ? 1 : (float)symbolic_iteration.num_spilled_object/num_generated_object;
+				size_t const used_memory = iteration.get_truncated_mem_size(0, chunk_begin, 0) + symbolic_iteration.num_spilled_object*symbolic_object_mem_size;
+				size_t const remaining_memory = symbolic_target_memory - std::min(symbolic_target_memory, used_memory + symbolic_chunk_memory);
+
+				/* select the remaining parents according to the survivor ratio after the first chunk, and again if they don't fit anymore */
+				if (chunk_begin == first_chunk_end || iteration.get_truncated_mem_size(chunk_begin, -1, survivor_ratio) > remaining_memory) {
+					mid_step_function("truncate_symbolic");
+					if (remaining_memory == 0) {
+						iteration.truncated_num_object = chunk_begin;
+					} else
+						iteration.truncate_mem_size(chunk_begin, remaining_memory, [&](size_t const oid) {
+							return iteration.get_object_mem_size(oid, survivor_ratio);
+						}, mid_step_function);
+				}
+
+				chunk_end = iteration.get_symbolic_chunk_end(chunk_begin);
+			}
+
+			/* interferences between chunks */
+			symbolic_iteration.compute_collisions(0, mid_step_function);
+			symbolic_iteration.num_spilled_object = 0;
+		}
 		symbolic_iteration.next_iteration_num_object = symbolic_iteration.num_object_after_interferences;
 
 
 		/* prepare truncate */
 		mid_step_function("truncate - prepare");
-		symbolic_iteration.prepare_truncate(mid_step_function);
+		symbolic_iteration.prepare_truncate(iteration.num_step, mid_step_function);
 
 		/* second max_num_object */
 		mid_step_function("truncate");
@@ -516,26 +871,17 @@ namespace quids {
 				next_iteration_mem = (1 - equalize_factor)*next_iteration_mem + equalize_factor*previous_iteration_mem;
 			}
 			size_t avail_memory = next_iteration_mem + quids::utils::get_free_mem();
+			if (next_iteration.is_file_backed())
+				avail_memory += quids::utils::get_free_disk_space();
 			size_t non_avail_memory = previous_iteration_mem + symbolic_iteration.get_mem_size();
 			size_t target_memory = (avail_memory + non_avail_memory)*(1 - quids::safety_margin) - non_avail_memory;
 
-			/* actually truncate by binary search */
-			if (symbolic_iteration.get_truncated_mem_size() > target_memory) {
-				size_t begin = 0, end = symbolic_iteration.num_object_after_interferences;
-				while (end > begin + 1) {
-					size_t middle = (end + begin) / 2;
-					symbolic_iteration.truncate(begin, middle, mid_step_function);
-
-					size_t used_memory = symbolic_iteration.get_truncated_mem_size(begin);
-					if (used_memory < target_memory) {
-						target_memory -= used_memory;
-						begin = middle;
-					} else
-						end = middle;
-				}
-			}
+			/* actually truncate */
+			if (symbolic_iteration.get_truncated_mem_size() > target_memory)
+				symbolic_iteration.truncate_mem_size(target_memory, mid_step_function);
 		} else
 			symbolic_iteration.truncate(0, max_num_object, mid_step_function);
+		PROFILE_OBJECTS(symbolic_iteration.num_object_after_interferences, symbolic_iteration.next_iteration_num_object);
 
 		/* finish simulation */
 		symbolic_iteration.finalize(rule, iteration, next_iteration, mid_step_function);
@@ -545,7 +891,8 @@ namespace quids {
 	/*
 	compute num child
 	*/
-	void iteration::compute_num_child(rule_t const *rule, debug_t mid_step_function) const {
+	template<class Rule>
+	void iteration::compute_num_child(Rule const &rule, debug_t mid_step_function) const {
 		/* !!!!!!!!!!!!!!!!
 		num_child
 		 !!!!!!!!!!!!!!!! */
@@ -559,31 +906,42 @@ namespace quids {
 		#pragma omp parallel for  reduction(max:ub_symbolic_object_size)
 		for (size_t oid = 0; oid < num_object; ++oid) {
 			uint size;
-			rule->get_num_child(&objects[object_begin[oid]],
+			rule.get_num_child(&objects[object_begin[oid]],
 				&objects[object_begin[oid] + object_size[oid]],
 				num_childs[oid], size);
 			ub_symbolic_object_size = std::max(ub_symbolic_object_size, size);
 		}
 
 		__gnu_parallel::partial_sum(num_childs.begin(), num_childs.begin() + num_object, child_begin.begin() + 1);
+
+		PROFILE_OBJECTS(num_object, child_begin[num_object]);
+		PROFILE_BYTES(object_begin[num_object] + num_object*(sizeof(uint) + sizeof(size_t)));
 	}
 
 	/*
-	get the truncated memory size
+	get the memory size of an object and its children
 	*/
-	size_t iteration::get_truncated_mem_size(size_t begin_num_object) const {
+	size_t iteration::get_object_mem_size(size_t oid, float symbolic_ratio) const {
 		static const size_t iteration_memory_size = ITERATION_MEMORY_SIZE;
 
 		static const float hash_map_size = HASH_MAP_OVERHEAD*2*sizeof(size_t);
 		static const size_t symbolic_iteration_memory_size = SYMBOLIC_ITERATION_MEMORY_SIZE;
 
-		size_t mem_size = iteration_memory_size*(truncated_num_object - begin_num_object);
-		for (size_t i = begin_num_object; i < truncated_num_object; ++i) {
-			size_t oid = truncated_oid[i];
+		/* symbolic_ratio is the fraction of the children that is charged (only the ones expected to survive interferences within their chunk, when generating the symbolic iteration by chunks) */
+		return iteration_memory_size + object_begin[oid + 1] - object_begin[oid] +
+			(size_t)(num_childs[oid]*symbolic_ratio*(symbolic_iteration_memory_size + hash_map_size));
+	}
 
-			mem_size += object_begin[oid + 1] - object_begin[oid];
-			mem_size += num_childs[oid]*(symbolic_iteration_memory_size + hash_map_size);
-		}
+	/*
+	get the truncated memory size
+	*/
+	size_t iteration::get_truncated_mem_size(size_t begin_num_object, size_t end_num_object, float symbolic_ratio) const {
+		end_num_object = std::min(end_num_object, truncated_num_object);
+
+		size_t mem_size = 0;
+		#pragma omp parallel for reduction(+:mem_size)
+		for (size_t i = begin_num_object; i < end_num_object; ++i)
+			mem_size += get_object_mem_size(truncated_oid[i], symbolic_ratio);
 
 		return mem_size*utils::upsize_policy;
 	}
@@ -596,15 +954,23 @@ namespace quids {
 		prepare pre_truncate
 		 !!!!!!!!!!!!!!!! */
 
-		if (!simple_truncation)
-			#pragma omp parallel
-			{
-				utils::random_generator rng;
+		/* cache probabilities, so that they aren't recomputed at each comparison when truncating */
+		utils::compute_norms(&magnitude[0], &magnitude[0] + num_object, &random_selector[0]);
 
-				#pragma omp for
-				for (size_t oid = 0; oid < num_object; ++oid)
-					random_selector[oid] = rng() / std::norm(magnitude[oid]); //-std::log(1 - rng()) / std::norm(magnitude[oid]);
+		if (simple_truncation) {
+			#pragma omp parallel for simd
+			for (size_t oid = 0; oid < num_object; ++oid)
+				random_selector[oid] = -random_selector[oid];
+		} else {
+			/* exponential keys (Efraimidis-Spirakis), with a random stream per object keyed by its hash */
+			uint64_t const counter = utils::hash_mix(random_seed) + 2*num_step;
+
+			#pragma omp parallel for
+			for (size_t oid = 0; oid < num_object; ++oid) {
+				size_t hash = std::hash<std::string_view>()(std::string_view(&objects[object_begin[oid]], object_size[oid]));
+				random_selector[oid] = -std::log(utils::counter_random(hash, counter)) / random_selector[oid];
 			}
+		}
 	}
 
 	/*
@@ -625,28 +991,41 @@ namespace quids {
 		auto middle = truncated_oid.begin() + max_num_object;
 		auto end = truncated_oid.begin() + truncated_num_object;
 
-		if (simple_truncation) {
-			/* truncation */
-			__gnu_parallel::nth_element(begin, middle, end,
-			[&](size_t const &oid1, size_t const &oid2) {
-				return std::norm(magnitude[oid1]) > std::norm(magnitude[oid2]);
-			});
-		} else
-			/* select graphs according to random selectors */
-			__gnu_parallel::nth_element(begin, middle, end,
-			[&](size_t const &oid1, size_t const &oid2) {
-				return random_selector[oid1] < random_selector[oid2];
-			});
+		/* select objects according to selectors */
+		__gnu_parallel::nth_element(begin, middle, end,
+		[&](size_t const &oid1, size_t const &oid2) {
+			return random_selector[oid1] < random_selector[oid2];
+		});
 
 		truncated_num_object = max_num_object;
 	}
 
+	/*
+	pre-truncate to a given memory size
+	*/
+	template<class memSizeFunctionType>
+	void iteration::truncate_mem_size(size_t begin_num_object, size_t max_mem_size, memSizeFunctionType const object_mem_size, debug_t mid_step_function) const {
+		/* !!!!!!!!!!!!!!!!
+		pre_truncate
+		 !!!!!!!!!!!!!!!! */
+
+		/* select objects according to selectors (objects before begin_num_object are kept) */
+		truncated_num_object = begin_num_object + utils::parallel_weighted_select(truncated_oid.begin() + begin_num_object, truncated_oid.begin() + num_object,
+		[&](size_t const oid) {
+			return random_selector[oid];
+		}, object_mem_size, max_mem_size/utils::upsize_policy);
+	}
+
 	/*
 	generate symbolic iteration
 	*/
-	void iteration::generate_symbolic_iteration(rule_t const *rule, sy_it_t &symbolic_iteration, debug_t mid_step_function) const {
-		if (truncated_num_object == 0) {
-			symbolic_iteration.num_object = 0;
+	template<class Rule>
+	void iteration::generate_symbolic_iteration(Rule const &rule, sy_it_t &symbolic_iteration, size_t begin_num_object, size_t end_num_object, debug_t mid_step_function) const {
+		/* children are appended after the objects spilled from previous chunks */
+		size_t const symbolic_begin = symbolic_iteration.num_spilled_object;
+
+		if (end_num_object == begin_num_object) {
+			symbolic_iteration.num_object = symbolic_begin;
 			mid_step_function("prepare_index");
 			mid_step_function("symbolic_iteration");
 			return;
@@ -663,34 +1042,67 @@ namespace quids {
 		 !!!!!!!!!!!!!!!! */
 		mid_step_function("prepare_index");
 
-		child_begin[0] = 0;
-		for (size_t i = 0; i < truncated_num_object; ++i) {
-			size_t oid = truncated_oid[i];
+		child_begin[0] = symbolic_begin;
+		#pragma omp parallel for
+		for (size_t i = begin_num_object; i < end_num_object; ++i)
+			child_begin[i - begin_num_object + 1] = num_childs[truncated_oid[i]];
 
-			child_begin[i + 1] = child_begin[i] + num_childs[oid];
-		}
+		__gnu_parallel::partial_sum(child_begin.begin(), child_begin.begin() + end_num_object - begin_num_object + 1, child_begin.begin());
 
-		symbolic_iteration.num_object = child_begin[truncated_num_object];
+		symbolic_iteration.num_object = child_begin[end_num_object - begin_num_object];
 
 		/* resize symbolic iteration */
+		size_t previous_symbolic_mem_size = symbolic_iteration.get_mem_size();
+		symbolic_iteration.retain_objects = false;
 		symbolic_iteration.resize(symbolic_iteration.num_object);
-		symbolic_iteration.reserve(ub_symbolic_object_size);
+
+		/* choose between retaining symbolic objects or regenerating them when finalizing (objects are never retained when generated by chunks).
+		Only the memory left once the symbolic iteration, its hashmap and the next iteration are accounted for is used for retained objects */
+		if (retain_symbolic_objects && begin_num_object == 0 && end_num_object == truncated_num_object) {
+			static const size_t symbolic_iteration_memory_size = SYMBOLIC_ITERATION_MEMORY_SIZE;
+			static const float hash_map_size = HASH_MAP_OVERHEAD*2*sizeof(size_t);
+
+			size_t staging_mem_size = symbolic_iteration.num_object*(ub_symbolic_object_size + sizeof(size_t))*utils::upsize_policy;
+			size_t symbolic_mem_size = symbolic_iteration.num_object*(symbolic_iteration_memory_size + hash_map_size)*utils::upsize_policy;
+			size_t next_iteration_mem_size = get_mem_size()*truncated_num_object/num_object;
+
+			size_t avail_memory = (utils::get_free_mem() + previous_symbolic_mem_size)*(1 - safety_margin);
+			symbolic_iteration.retain_objects = staging_mem_size + symbolic_mem_size + next_iteration_mem_size < avail_memory;
+			if (symbolic_iteration.retain_objects)
+				symbolic_iteration.retained_begin.resize(symbolic_iteration.num_object);
+		}
+
+		int num_threads;
+		#pragma omp parallel
+		#pragma omp single
+		num_threads = omp_get_num_threads();
+
+		symbolic_iteration.scratch.resize(num_threads);
+
+		if (symbolic_iteration.retain_objects)
+			symbolic_iteration.reserve_staging(num_threads);
 		
 		#pragma omp parallel
 		{
 			auto thread_id = omp_get_thread_num();
 
 			#pragma omp for 
-			for (size_t i = 0; i < truncated_num_object; ++i) {
+			for (size_t i = begin_num_object; i < end_num_object; ++i) {
 				size_t oid = truncated_oid[i];
+				size_t this_child_begin = child_begin[i - begin_num_object], this_child_end = child_begin[i - begin_num_object + 1];
 
 				/* assign parent ids and child ids for each child */
-				std::fill(&symbolic_iteration.parent_oid[child_begin[i]],
-					&symbolic_iteration.parent_oid[child_begin[i + 1]],
+				std::fill(&symbolic_iteration.parent_oid[this_child_begin],
+					&symbolic_iteration.parent_oid[this_child_end],
 					oid);
-				std::iota(&symbolic_iteration.child_id[child_begin[i]],
-					&symbolic_iteration.child_id[child_begin[i + 1]],
+				std::iota(&symbolic_iteration.child_id[this_child_begin],
+					&symbolic_iteration.child_id[this_child_end],
 					0);
+
+				/* hash parents, so that children hashes can be deduced from them */
+				if (rule.has_child_hasher())
+					object_hash[oid] = rule.hasher(&objects[object_begin[oid]],
+						&objects[object_begin[oid] + object_size[oid]]);
 			}
 
 
@@ -701,37 +1113,127 @@ namespace quids {
 			 !!!!!!!!!!!!!!!! */
 			#pragma omp single
 			mid_step_function("symbolic_iteration");
+			PROFILE_THREAD_BEGIN;
+
+			if (symbolic_iteration.retain_objects) {
+				/* each thread retains a contiguous range of children in its own staging buffer */
+				size_t begin = symbolic_iteration.staging_begin[thread_id], end = symbolic_iteration.staging_begin[thread_id + 1];
+				auto &staging = *symbolic_iteration.staging[thread_id];
+
+				size_t offset = 0;
+				staging.resize((end - begin)*get_object_length()/num_object);
+
+				for (size_t oid = begin; oid < end; ++oid) {
+					auto id = symbolic_iteration.parent_oid[oid];
+
+					if (staging.size() < offset + ub_symbolic_object_size)
+						staging.resize(offset + ub_symbolic_object_size);
+					char* const child_begin = &staging[offset];
+
+					/* generate graph */
+					mag_t mag = magnitude[id];
+					rule.populate_child(&objects[object_begin[id]],
+						&objects[object_begin[id] + object_size[id]],
+						child_begin, symbolic_iteration.child_id[oid],
+						symbolic_iteration.size[oid], mag);
+					symbolic_iteration.magnitude[oid] = mag;
+
+					/* compute hash */
+					symbolic_iteration.hash[oid] = rule.child_hasher(&objects[object_begin[id]],
+						&objects[object_begin[id] + object_size[id]],
+						object_hash[id], child_begin, child_begin + symbolic_iteration.size[oid],
+						symbolic_iteration.child_id[oid]);
+
+					symbolic_iteration.retained_begin[oid] = offset;
+					offset += symbolic_iteration.size[oid];
+				}
 
-			#pragma omp for 
-			for (size_t oid = 0; oid < symbolic_iteration.num_object; ++oid) {
-				auto id = symbolic_iteration.parent_oid[oid];
-
-				/* generate graph */
-				symbolic_iteration.magnitude[oid] = magnitude[id];
-				rule->populate_child(&objects[object_begin[id]],
-					&objects[object_begin[id] + object_size[id]],
-					symbolic_iteration.placeholder[thread_id], symbolic_iteration.child_id[oid],
-					symbolic_iteration.size[oid], symbolic_iteration.magnitude[oid]);
-
-				/* compute hash */
-				symbolic_iteration.hash[oid] = rule->hasher(symbolic_iteration.placeholder[thread_id],
-					symbolic_iteration.placeholder[thread_id] + symbolic_iteration.size[oid]);
+				staging.resize(offset);
+			} else {
+				/* each thread generates a contiguous range of children, sibling by sibling */
+				size_t num_symbolic_object = symbolic_iteration.num_object - symbolic_begin;
+				size_t begin = symbolic_begin + num_symbolic_object*thread_id/num_threads;
+				size_t end = symbolic_begin + num_symbolic_object*(thread_id + 1)/num_threads;
+				/* magnitudes buffer follows the placeholder in the scratch buffer */
+				size_t const placeholder_size = (ub_symbolic_object_size + utils::scratch_arena::alignment - 1)/utils::scratch_arena::alignment*utils::scratch_arena::alignment;
+
+				for (size_t oid = begin; oid < end;) {
+					auto id = symbolic_iteration.parent_oid[oid];
+					uint first_child_id = symbolic_iteration.child_id[oid];
+					uint num_child = std::min((size_t)(num_childs[id] - first_child_id), end - oid);
+
+					/* generate graphs */
+					if constexpr (std::is_same<stored_mag_t, mag_t>::value) {
+						char *placeholder = symbolic_iteration.scratch.get(thread_id, ub_symbolic_object_size);
+
+						std::fill(&symbolic_iteration.magnitude[oid],
+							&symbolic_iteration.magnitude[oid + num_child],
+							magnitude[id]);
+						rule.populate_children(&objects[object_begin[id]],
+							&objects[object_begin[id] + object_size[id]], object_hash[id],
+							placeholder, first_child_id, num_child,
+							&symbolic_iteration.size[oid], &symbolic_iteration.magnitude[oid], &symbolic_iteration.hash[oid]);
+					} else {
+						char *placeholder = symbolic_iteration.scratch.get(thread_id, placeholder_size + num_child*sizeof(mag_t));
+						mag_t *mag_buffer = (mag_t*)(placeholder + placeholder_size);
+
+						/* magnitudes are computed using PROBA_TYPE, and only then stored */
+						std::fill(mag_buffer, mag_buffer + num_child, magnitude[id]);
+						rule.populate_children(&objects[object_begin[id]],
+							&objects[object_begin[id] + object_size[id]], object_hash[id],
+							placeholder, first_child_id, num_child,
+							&symbolic_iteration.size[oid], mag_buffer, &symbolic_iteration.hash[oid]);
+						std::copy(mag_buffer, mag_buffer + num_child, &symbolic_iteration.magnitude[oid]);
+					}
+
+					oid += num_child;
+				}
 			}
+			PROFILE_THREAD_END;
 		}
+
+		PROFILE_OBJECTS(end_num_object - begin_num_object, symbolic_iteration.num_object - symbolic_begin);
+		PROFILE_BYTES((symbolic_iteration.num_object - symbolic_begin)*(sizeof(stored_mag_t) + 3*sizeof(size_t) + 2*sizeof(uint)));
 	}
 
 	/*
 	compute interferences
 	*/
-	void symbolic_iteration::compute_collisions(debug_t mid_step_function) {
-		if (num_object == 0) {
-			num_object_after_interferences = 0;
+	void symbolic_iteration::compute_collisions(size_t begin_num_object, debug_t mid_step_function) {
+		if (num_object == begin_num_object) {
+			num_object_after_interferences = begin_num_object;
 			mid_step_function("compute_collisions - prepare");
 			mid_step_function("compute_collisions - insert");
 			mid_step_function("compute_collisions - finalize");
 			return;
 		}
 
+		eliminate_duplicates(begin_num_object, mid_step_function);
+		mid_step_function("compute_collisions - finalize");
+
+
+
+
+
+		/* !!!!!!!!!!!!!!!!
+		partition
+		!!!!!!!!!!!!!!!! */
+		/* cache probabilities (reused by prepare_truncate) */
+		utils::compute_norms(&magnitude[begin_num_object], &magnitude[0] + num_object, &random_selector[begin_num_object]);
+
+		size_t* partitioned_it = __gnu_parallel::partition(&next_oid[begin_num_object], &next_oid[0] + num_object,
+			[&](size_t const &oid) {
+				/* compared in PROBA_TYPE, as the cached (float) probability can underflow a small tolerance */
+				return std::norm((mag_t)magnitude[oid]) > tolerance;
+			});
+		num_object_after_interferences = std::distance(&next_oid[0], partitioned_it);
+		PROFILE_OBJECTS(num_object - begin_num_object, num_object_after_interferences - begin_num_object);
+	}
+
+	/*
+	add the magnitudes of duplicates to a single one of them, and zero the others
+	*/
+	void symbolic_iteration::eliminate_duplicates(size_t begin_num_object, debug_t mid_step_function) {
 		int num_threads;
 		#pragma omp parallel
 		#pragma omp single
@@ -752,7 +1254,7 @@ namespace quids {
 		partition
 		!!!!!!!!!!!!!!!! */
 		mid_step_function("compute_collisions - prepare");
-		quids::utils::parallel_generalized_partition_from_iota(&next_oid[0], &next_oid[0] + num_object, 0,
+		quids::utils::parallel_generalized_partition_from_iota(&next_oid[begin_num_object], &next_oid[0] + num_object, begin_num_object,
 			&partition_begin[0], &partition_begin[num_bucket + 1],
 			[&](size_t const oid) {
 				return hash[oid] >> offset;
@@ -773,6 +1275,11 @@ namespace quids {
 			load_balancing_begin[i] = i*num_bucket/num_threads;
 #endif
 
+		/* partitions are relative to the first object considered */
+		if (begin_num_object > 0)
+			for (auto &begin : partition_begin)
+				begin += begin_num_object;
+
 
 
 
@@ -782,80 +1289,169 @@ namespace quids {
 		compute-collision
 		!!!!!!!!!!!!!!!! */
 		mid_step_function("compute_collisions - insert");
+#ifdef FLAT_COLLISION_TABLE
+		reserve_collision_tables(num_threads);
+#endif
 		#pragma omp parallel
 		{
+			PROFILE_THREAD_BEGIN;
 			int thread_id = omp_get_thread_num();
 			int load_begin = load_balancing_begin[thread_id], load_end = load_balancing_begin[thread_id + 1];
-			for (int j = load_begin; j < load_end; ++j) {
-				robin_hood::unordered_map<size_t, size_t> elimination_map;
 
-				size_t begin = partition_begin[j], end = partition_begin[j + 1];
+			/* magnitudes stored with a lower precision are accumulated using PROBA_TYPE, which requires sorting */
+			if (radix_sort_collisions || !std::is_same<stored_mag_t, mag_t>::value) {
+				/* buffers reused for all buckets of this thread */
+				std::vector<std::pair<size_t, size_t>> sorted_hash, sort_buffer;
 
-				elimination_map.reserve(end - begin);
-				for (size_t i = begin; i < end; ++i) {
-					size_t oid = next_oid[i];
+				for (int j = load_begin; j < load_end; ++j) {
+					size_t begin = partition_begin[j], end = partition_begin[j + 1];
 
-					/* accessing key */
-					auto [it, unique] = elimination_map.insert({hash[oid], oid});
-					if (!unique) {
-						const size_t other_oid = it->second;
+					/* sort (hash, oid) pairs */
+					sorted_hash.resize(end - begin);
+					sort_buffer.resize(end - begin);
+					for (size_t i = begin; i < end; ++i) {
+						size_t oid = next_oid[i];
+						sorted_hash[i - begin] = {hash[oid], oid};
+					}
+					utils::radix_sort_by_key(sorted_hash.data(), sorted_hash.data() + (end - begin), sort_buffer.data());
+
+					/* add probabilities of equal hashes to the first one (the sort is stable, so it's the same object a hashmap would keep) */
+					for (size_t first = 0, i; first < end - begin; first = i) {
+						mag_t mag = magnitude[sorted_hash[first].second];
+						for (i = first + 1; i < end - begin && sorted_hash[i].first == sorted_hash[first].first; ++i) {
+							mag                             += (mag_t)magnitude[sorted_hash[i].second];
+							magnitude[sorted_hash[i].second] = 0;
+						}
+
+						if (i > first + 1)
+							magnitude[sorted_hash[first].second] = mag;
+					}
+				}
+			} else
+				for (int j = load_begin; j < load_end; ++j) {
+					size_t begin = partition_begin[j], end = partition_begin[j + 1];
 
-						/* if it exist add the probabilities */
-						magnitude[other_oid] += magnitude[oid];
-						magnitude[oid]        = 0;
+#ifdef FLAT_COLLISION_TABLE
+					auto &elimination_map = *collision_tables[thread_id];
+					elimination_map.reset(end - begin);
+#else
+					robin_hood::unordered_map<size_t, size_t> elimination_map;
+					elimination_map.reserve(end - begin);
+#endif
+					for (size_t i = begin; i < end; ++i) {
+						size_t oid = next_oid[i];
+
+						/* accessing key */
+						auto [it, unique] = elimination_map.insert({hash[oid], oid});
+						if (!unique) {
+							const size_t other_oid = it->second;
+
+							/* if it exist add the probabilities */
+							magnitude[other_oid] += magnitude[oid];
+							magnitude[oid]        = 0;
+						}
 					}
 				}
-			}
+			PROFILE_THREAD_END;
 		}
-		mid_step_function("compute_collisions - finalize");
+		PROFILE_BYTES((num_object - begin_num_object)*(2*sizeof(size_t) + sizeof(stored_mag_t)));
+	}
 
+	/*
+	spill objects that survived interferences within a chunk
+	*/
+	void symbolic_iteration::spill(debug_t mid_step_function) {
+		/* !!!!!!!!!!!!!!!!
+		spill
+		 !!!!!!!!!!!!!!!! */
+		mid_step_function("spill");
 
+		/* sort so that objects are only moved toward the begining */
+		__gnu_parallel::sort(&next_oid[num_spilled_object], &next_oid[0] + num_object_after_interferences);
 
+		/* move surviving objects right after previously spilled objects */
+		gather_spilled(&magnitude[0]);
+		gather_spilled(&hash[0]);
+		gather_spilled(&size[0]);
+		gather_spilled(&parent_oid[0]);
+		gather_spilled(&child_id[0]);
 
+		num_spilled_object = num_object_after_interferences;
+		num_object = num_spilled_object;
+	}
 
-		/* !!!!!!!!!!!!!!!!
-		partition
-		!!!!!!!!!!!!!!!! */
-		size_t* partitioned_it = __gnu_parallel::partition(&next_oid[0], &next_oid[0] + num_object,
-			[&](size_t const &oid) {
-				return std::norm(magnitude[oid]) > tolerance;
-			});
-		num_object_after_interferences = std::distance(&next_oid[0], partitioned_it);
+	/*
+	gather the objects that survived interferences within a chunk, in parallel through next_oid_partitioner_buffer
+	*/
+	template<typename T>
+	void symbolic_iteration::gather_spilled(T *array) {
+		/* objects are only moved toward the begining, so the range can be gathered by parts if the buffer is too small */
+		size_t const min_buffer_size = (sizeof(T) + alignof(T))/sizeof(size_t) + 1;
+		if (next_oid_partitioner_buffer.size() < min_buffer_size)
+			next_oid_partitioner_buffer.resize(min_buffer_size);
+
+		void *buffer_begin = &next_oid_partitioner_buffer[0];
+		size_t buffer_space = next_oid_partitioner_buffer.size()*sizeof(size_t);
+		T *buffer = (T*)std::align(alignof(T), sizeof(T), buffer_begin, buffer_space);
+		size_t const buffer_size = buffer_space/sizeof(T);
+
+		for (size_t begin = num_spilled_object; begin < num_object_after_interferences; begin += buffer_size) {
+			size_t const end = std::min(begin + buffer_size, num_object_after_interferences);
+
+			#pragma omp parallel for
+			for (size_t i = begin; i < end; ++i)
+				buffer[i - begin] = array[next_oid[i]];
+
+			#pragma omp parallel for
+			for (size_t i = begin; i < end; ++i)
+				array[i] = buffer[i - begin];
+		}
 	}
 
 	/*
 	prepare truncate
 	*/
-	void symbolic_iteration::prepare_truncate(debug_t mid_step_function) {
+	void symbolic_iteration::prepare_truncate(size_t num_step, debug_t mid_step_function) {
 		/* !!!!!!!!!!!!!!!!
 		prepare truncate
 		 !!!!!!!!!!!!!!!! */
 
-		if (!simple_truncation)
-			#pragma omp parallel
-			{
-				utils::random_generator rng;
+		/* probabilities were cached by compute_collisions */
+		if (simple_truncation) {
+			#pragma omp parallel for
+			for (size_t i = 0; i < num_object_after_interferences; ++i) {
+				size_t oid = next_oid[i];
+				random_selector[oid] = -random_selector[oid];
+			}
+		} else {
+			/* exponential keys (Efraimidis-Spirakis), with a random stream per object keyed by its hash */
+			uint64_t const counter = utils::hash_mix(random_seed) + 2*num_step + 1;
 
-				#pragma omp for
-				for (size_t i = 0; i < num_object_after_interferences; ++i) {
-					size_t oid = next_oid[i];
-					random_selector[oid] = rng() / std::norm(magnitude[oid]); //-std::log(1 - rng()) / std::norm(magnitude[oid]);
-				}
+			#pragma omp parallel for
+			for (size_t i = 0; i < num_object_after_interferences; ++i) {
+				size_t oid = next_oid[i];
+				random_selector[oid] = -std::log(utils::counter_random(hash[oid], counter)) / random_selector[oid];
 			}
+		}
 	}
 
 	/*
-	get the truncated memory size
+	get the memory size of an object in the next iteration
 	*/
-	size_t symbolic_iteration::get_truncated_mem_size(size_t begin_num_object) const {
+	size_t symbolic_iteration::get_object_mem_size(size_t oid) const {
 		static const size_t iteration_memory_size = ITERATION_MEMORY_SIZE;
 
-		size_t mem_size = iteration_memory_size*(next_iteration_num_object - begin_num_object);
-		for (size_t i = begin_num_object; i < next_iteration_num_object; ++i) {
-			size_t this_mem_size = size[next_oid[i]];
-			uint alignment_offset = get_alignment_offset(this_mem_size);
-			mem_size += this_mem_size + alignment_offset;
-		}
+		return iteration_memory_size + size[oid] + get_alignment_offset(size[oid]);
+	}
+
+	/*
+	get the truncated memory size
+	*/
+	size_t symbolic_iteration::get_truncated_mem_size(size_t begin_num_object) const {
+		size_t mem_size = 0;
+		#pragma omp parallel for reduction(+:mem_size)
+		for (size_t i = begin_num_object; i < next_iteration_num_object; ++i)
+			mem_size += get_object_mem_size(next_oid[i]);
 
 		return mem_size;
 	}
@@ -881,28 +1477,45 @@ namespace quids {
 		auto middle = next_oid.begin() + max_num_object;
 		auto end = next_oid.begin() + next_iteration_num_object;
 
-		if (simple_truncation) {
-			/* truncation */
-			__gnu_parallel::nth_element(begin, middle, end,
-			[&](size_t const &oid1, size_t const &oid2) {
-				return std::norm(magnitude[oid1]) > std::norm(magnitude[oid2]);
-			});
-		} else {
-			/* select graphs according to random selectors */
-			__gnu_parallel::nth_element(begin, middle, end,
-			[&](size_t const &oid1, size_t const &oid2) {
-				return random_selector[oid1] < random_selector[oid2];
-			});
-		}
+		/* select objects according to selectors */
+		__gnu_parallel::nth_element(begin, middle, end,
+		[&](size_t const &oid1, size_t const &oid2) {
+			return random_selector[oid1] < random_selector[oid2];
+		});
 
 		
 		next_iteration_num_object = max_num_object;
 	}
 
+	/*
+	truncate to a given memory size
+	*/
+	void symbolic_iteration::truncate_mem_size(size_t max_mem_size, debug_t mid_step_function) {
+		if (next_iteration_num_object == 0)
+			return;
+
+		/* !!!!!!!!!!!!!!!!
+		truncate
+		 !!!!!!!!!!!!!!!! */
+
+		auto const object_mem_size = [&](size_t const oid) {
+			return get_object_mem_size(oid);
+		};
+
+		/* select objects according to selectors */
+		next_iteration_num_object = utils::parallel_weighted_select(next_oid.begin(), next_oid.begin() + num_object_after_interferences,
+		[&](size_t const oid) {
+			return random_selector[oid];
+		}, object_mem_size, max_mem_size);
+	}
+
 	/*
 	finalize iteration
 	*/
-	void symbolic_iteration::finalize(rule_t const *rule, it_t const &last_iteration, it_t &next_iteration, debug_t mid_step_function) {
+	template<class Rule>
+	void symbolic_iteration::finalize(Rule const &rule, it_t const &last_iteration, it_t &next_iteration, debug_t mid_step_function) {
+		next_iteration.num_step = last_iteration.num_step + 1;
+
 		if (next_iteration_num_object == 0) {
 			next_iteration.num_object = 0;
 			mid_step_function("prepare_final");
@@ -922,6 +1535,7 @@ namespace quids {
 		 !!!!!!!!!!!!!!!! */
 		mid_step_function("prepare_final");
 		next_iteration.num_object = next_iteration_num_object;
+		next_iteration.advise(MADV_SEQUENTIAL);
 
 		/* sort to make memory access more continuous */
 		__gnu_parallel::sort(&next_oid[0], &next_oid[0] + next_iteration.num_object);
@@ -955,28 +1569,48 @@ namespace quids {
 		 !!!!!!!!!!!!!!!! */
 		mid_step_function("final");
 
-		#pragma omp parallel for 
-		for (size_t oid = 0; oid < next_iteration.num_object; ++oid) {
-			auto id = next_oid[oid];
-			auto this_parent_oid = parent_oid[id];
-				
-			rule->populate_child_simple(&last_iteration.objects[last_iteration.object_begin[this_parent_oid]],
-				&last_iteration.objects[last_iteration.object_begin[this_parent_oid] + last_iteration.object_size[this_parent_oid]],
-				&next_iteration.objects[next_iteration.object_begin[oid]],
-				child_id[id]);
-		}
+		if (retain_objects) {
+			/* copy retained objects */
+			#pragma omp parallel for 
+			for (size_t oid = 0; oid < next_iteration.num_object; ++oid) {
+				auto id = next_oid[oid];
+				int staging_id = std::distance(staging_begin.begin(), std::upper_bound(staging_begin.begin(), staging_begin.end(), id)) - 1;
+				char const *retained_object_begin = &(*staging[staging_id])[retained_begin[id]];
+
+				std::copy(retained_object_begin, retained_object_begin + size[id],
+					&next_iteration.objects[next_iteration.object_begin[oid]]);
+			}
+		} else
+			#pragma omp parallel for 
+			for (size_t oid = 0; oid < next_iteration.num_object; ++oid) {
+				auto id = next_oid[oid];
+				auto this_parent_oid = parent_oid[id];
+					
+				rule.populate_child_simple(&last_iteration.objects[last_iteration.object_begin[this_parent_oid]],
+					&last_iteration.objects[last_iteration.object_begin[this_parent_oid] + last_iteration.object_size[this_parent_oid]],
+					&next_iteration.objects[next_iteration.object_begin[oid]],
+					child_id[id]);
+			}
+
+		PROFILE_OBJECTS(next_iteration.num_object, next_iteration.num_object);
+		PROFILE_BYTES(next_iteration.object_begin[next_iteration.num_object]);
 	}
 
 	/*
 	apply modifier
 	*/
-	void iteration::apply_modifier(modifier_t const rule) {
+	template<class Modifier>
+	void iteration::apply_modifier(Modifier const &rule) {
 		#pragma omp parallel for 
-		for (size_t oid = 0; oid < num_object; ++oid)
+		for (size_t oid = 0; oid < num_object; ++oid) {
+			mag_t mag = magnitude[oid];
+
 			/* generate graph */
 			rule(&objects[object_begin[oid]],
 				&objects[object_begin[oid] + object_size[oid]],
-				magnitude[oid]);
+				mag);
+			magnitude[oid] = mag;
+		}
 	}
 
 	/*
@@ -998,20 +1632,18 @@ namespace quids {
 		normalize
 		 !!!!!!!!!!!!!!!! */
 		mid_step_function("normalize");
+		magnitude.advise(MADV_SEQUENTIAL);
 
-		#pragma omp parallel
-		{
-			#pragma omp for reduction(+:total_proba)
-			for (size_t oid = 0; oid < num_object; ++oid)
-				total_proba += std::norm(magnitude[oid]);
+		total_proba = utils::norm_sum<PROBA_TYPE>(&magnitude[0], &magnitude[0] + num_object);
+		PROBA_TYPE normalization_factor = std::sqrt(total_proba);
 
-			PROBA_TYPE normalization_factor = std::sqrt(total_proba);
+		/* multiplied in PROBA_TYPE, even if magnitudes are stored with a lower precision */
+		if (normalization_factor != 1)
+			utils::scale<PROBA_TYPE>(&magnitude[0], &magnitude[0] + num_object, 1/normalization_factor);
+		advise(MADV_NORMAL);
 
-			if (normalization_factor != 1)
-				#pragma omp for
-				for (size_t oid = 0; oid < num_object; ++oid)
-					magnitude[oid] /= normalization_factor;
-		}
+		PROFILE_OBJECTS(num_object, num_object);
+		PROFILE_BYTES(2*num_object*sizeof(stored_mag_t));
 		
 		mid_step_function("end");
 	}
@@ -9,6 +9,7 @@ typedef unsigned uint;
 #include <mpi.h>
 
 #include "utils/mpi_utils.hpp"
+#include "utils/codec.hpp"
 
 #ifndef MIN_EQUALIZE_SIZE
 	#define MIN_EQUALIZE_SIZE 100
@@ -19,9 +20,8 @@ typedef unsigned uint;
 	 * The idea is that GRANULARITY should be large  enough for the loop to gain from cache optimization,
 	 * while being small enough to be considered "small" compared to the number of object per thread.
 	 * 
-	 * This is used to introduce some "implicite work stealing" without killing performance,
-	 * by inserting "GRANULARITY" object from each node into the hashmap when computing collisions,
-	 * before moving to the next node.
+	 * This is used when computing collisions, to check for the progress of pending communications
+	 * every "GRANULARITY" objects inserted into the hashmap, without killing performance.
 	 */
 	#define GRANULARITY 64
 #endif
@@ -41,6 +41,8 @@ namespace quids::mpi {
 	const static MPI_Datatype Proba_MPI_Datatype = utils::get_mpi_datatype((PROBA_TYPE)0);
 	/// mpi datatype corresponding to complex magnitudes.
 	const static MPI_Datatype mag_MPI_Datatype = utils::get_mpi_datatype((std::complex<PROBA_TYPE>)0);
+	/// mpi datatype corresponding to stored complex magnitudes.
+	const static MPI_Datatype stored_mag_MPI_Datatype = utils::get_mpi_datatype((std::complex<STORED_PROBA_TYPE>)0);
 
 	/// minimum number of object that should be attained (in at least one node) before equalizing (load-sharing) bewteen nodes.
 	size_t min_equalize_size = MIN_EQUALIZE_SIZE;
@@ -54,12 +56,108 @@ namespace quids::mpi {
 #else
 	bool equalize_children = true;
 #endif
+	/// if true, eliminate duplicates locally before sharing objects to compute collisions, so that only locally unique objects are sent.
+#ifdef LOCAL_AGGREGATION
+	bool local_aggregation = true;
+#else
+	bool local_aggregation = false;
+#endif
+	/// if true, objects exchanged to compute collisions are compressed: hashes are sorted, and delta and varint encoded.
+#ifdef COMPRESS_EXCHANGE
+	bool compress_exchange = true;
+#else
+	bool compress_exchange = false;
+#endif
+	/// if true (and if compress_exchange is true), magnitudes are exchanged as single precision complex numbers, which is lossy.
+#ifdef QUANTIZE_MAGNITUDE
+	bool quantize_magnitude = true;
+#else
+	bool quantize_magnitude = false;
+#endif
+
+	/// persistent mpi context, caching the topology of a communicator and the buffers used to exchange objects.
+	/**
+	 * The shared-memory sub-communicator is only created once, rather than at every step.
+	 * A context should be created after MPI_Init. Exchanges always use the number of OpenMP threads cached by the context,
+	 * regardless of later changes to the number of threads (which only require recreating the context to be taken into account).
+	 * It can be passed to any function expecting an MPI_Comm.
+	 */
+	class context {
+	public:
+		/// communicator from which the context was created.
+		MPI_Comm communicator;
+		/// shared-memory sub-communicator (ranks sharing the same memory).
+		MPI_Comm local_communicator;
+		/// rank and number of ranks in the communicator.
+		int rank, size;
+		/// rank and number of ranks in the shared-memory sub-communicator.
+		int local_rank, local_size;
+		/// number of OpenMP threads per rank.
+		int num_threads;
+
+		/// constructor from a communicator.
+		/**
+		 * @param[in] communicator_ MPI communcator (which should outlive the context).
+		 */
+		explicit context(MPI_Comm communicator_) : communicator(communicator_) {
+			MPI_Comm_size(communicator, &size);
+			MPI_Comm_rank(communicator, &rank);
+			MPI_Comm_split_type(communicator, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &local_communicator);
+			MPI_Comm_size(local_communicator, &local_size);
+			MPI_Comm_rank(local_communicator, &local_rank);
+
+			#pragma omp parallel
+			#pragma omp single
+			num_threads = omp_get_num_threads();
+
+			/* count and displacement buffers, per segment (one per thread of each rank) and per rank */
+			int const n_segment = size*num_threads;
+			for (auto *buffer : {&local_disp, &global_disp, &local_word_disp, &global_word_disp})
+				buffer->resize(n_segment + 1, 0);
+			for (auto *buffer : {&local_count, &global_count, &modified_count, &local_word_count, &global_word_count})
+				buffer->resize(n_segment);
+			for (auto *buffer : {&send_disp, &receive_disp})
+				buffer->resize(size + 1, 0);
+			for (auto *buffer : {&send_count, &receive_count, &share_back_send_count, &share_back_receive_count})
+				buffer->resize(size);
+
+			receive_requests.resize(size, MPI_REQUEST_NULL);
+			send_requests.resize(size, MPI_REQUEST_NULL);
+			share_back_datatypes.resize(size);
+		}
+		~context() {
+			int finalized;
+			MPI_Finalized(&finalized);
+			if (!finalized)
+				MPI_Comm_free(&local_communicator);
+		}
+		context(context const &) = delete;
+		context &operator=(context const &) = delete;
+
+		/// implicit conversion to the underlying communicator.
+		operator MPI_Comm() const {
+			return communicator;
+		}
+
+	private:
+		friend class mpi_symbolic_iteration;
+
+		std::vector<int> local_disp, local_count, global_disp, global_count, modified_count;
+		std::vector<int> local_word_disp, local_word_count, global_word_disp, global_word_count;
+		std::vector<int> send_disp, send_count, receive_disp, receive_count;
+		std::vector<int> share_back_send_count, share_back_receive_count;
+		std::vector<MPI_Request> receive_requests, send_requests;
+		std::vector<MPI_Datatype> share_back_datatypes;
+	};
 
 	/// mpi iteration type
 	typedef class mpi_iteration mpi_it_t;
 	/// mpi symbolic iteration type
 	typedef class mpi_symbolic_iteration mpi_sy_it_t;
 
+	template<class Rule>
+	void simulate(mpi_it_t &iteration, Rule const &rule, mpi_it_t &next_iteration, mpi_sy_it_t &symbolic_iteration, context &mpi_context, size_t max_num_object=0, quids::debug_t mid_step_function=[](const char*){});
+
 	/// mpi iteration (wave function) class, ineriting from the quids::iteration class
 	class mpi_iteration : public quids::iteration {
 	public:
@@ -98,20 +196,44 @@ namespace quids::mpi {
 		/**
 		 * @param[in] observable observable that should be computed.
 		 */
-		PROBA_TYPE average_value(const quids::observable_t observable) const {
-			return node_total_proba == 0 ? 0 : quids::iteration::average_value(observable) / node_total_proba * total_proba;
+		template<class Observable>
+		PROBA_TYPE average_value(Observable const &observable) const {
+			return average_values(observable)[0];
+		}
+		/// function to get the average local values of multiple custom observables in a single pass over the local wave function.
+		/**
+		 * @param[in] observables observables that should be computed.
+		 * @return average local value of each observable, in the same order as observables.
+		 */
+		template<class... Observables>
+		std::array<PROBA_TYPE, sizeof...(Observables)> average_values(Observables const &...observables) const {
+			auto avg = quids::iteration::average_values(observables...);
+			for (auto &this_avg : avg)
+				this_avg = node_total_proba == 0 ? 0 : this_avg / node_total_proba * total_proba;
+			return avg;
 		}
 		/// function to get the average value of a custom observable accross the total distributed wave function.
 		/**
 		 * @param[in] observable observable that should be computed.
 		 * @param[in] communicator MPI communcator.
 		 */
-		PROBA_TYPE average_value(const quids::observable_t 	observable, MPI_Comm communicator) const {
-			/* compute local average */
-			PROBA_TYPE avg = quids::iteration::average_value(observable);
+		template<class Observable>
+		PROBA_TYPE average_value(Observable const &observable, MPI_Comm communicator) const {
+			return average_values(communicator, observable)[0];
+		}
+		/// function to get the average values of multiple custom observables accross the total distributed wave function, in a single pass and a single reduction.
+		/**
+		 * @param[in] communicator MPI communcator.
+		 * @param[in] observables observables that should be computed.
+		 * @return average value of each observable, in the same order as observables.
+		 */
+		template<class... Observables>
+		std::array<PROBA_TYPE, sizeof...(Observables)> average_values(MPI_Comm communicator, Observables const &...observables) const {
+			/* compute local averages */
+			auto avg = quids::iteration::average_values(observables...);
 
-			/* accumulate average value */
-			MPI_Allreduce(MPI_IN_PLACE, &avg, 1, Proba_MPI_Datatype, MPI_SUM, communicator);
+			/* accumulate average values */
+			MPI_Allreduce(MPI_IN_PLACE, &avg[0], sizeof...(Observables), Proba_MPI_Datatype, MPI_SUM, communicator);
 			return avg;
 		}
 		/// function to send objects (from the "tail" of the memory representation).
@@ -144,7 +266,7 @@ namespace quids::mpi {
 					object_begin[i] -= send_object_begin;
 
 				/* send properties */
-				MPI_Send(&magnitude[begin], num_object_sent, mag_MPI_Datatype, node, 0 /* tag */, communicator);
+				MPI_Send(&magnitude[begin], num_object_sent, stored_mag_MPI_Datatype, node, 0 /* tag */, communicator);
 				MPI_Send(&object_begin[begin + 1], num_object_sent, MPI_UNSIGNED_LONG_LONG, node, 0 /* tag */, communicator);
 				MPI_Send(&object_size[begin], num_object_sent, MPI_UNSIGNED, node, 0 /* tag */, communicator);
 
@@ -196,7 +318,7 @@ namespace quids::mpi {
 				allocate(send_object_begin + send_object_size);
 
 				/* receive properties */
-				MPI_Recv(&magnitude[num_object], num_object_sent, mag_MPI_Datatype, node, 0 /* tag */, communicator, MPI_STATUS_IGNORE);
+				MPI_Recv(&magnitude[num_object], num_object_sent, stored_mag_MPI_Datatype, node, 0 /* tag */, communicator, MPI_STATUS_IGNORE);
 				MPI_Recv(&object_begin[num_object + 1], num_object_sent, MPI_UNSIGNED_LONG_LONG, node, 0 /* tag */, communicator, MPI_STATUS_IGNORE);
 				MPI_Recv(&object_size[num_object], num_object_sent, MPI_UNSIGNED, node, 0 /* tag */, communicator, MPI_STATUS_IGNORE);
 
@@ -234,7 +356,15 @@ namespace quids::mpi {
 		/**
 		 * @param[in] communicator MPI communcator.
 		 */
-		void equalize(MPI_Comm communicator);
+		void equalize(MPI_Comm communicator) {
+			context mpi_context(communicator);
+			equalize(mpi_context);
+		}
+		/// equalize the number of object across node pairs.
+		/**
+		 * @param[in] mpi_context persistent MPI context.
+		 */
+		void equalize(context &mpi_context);
 		/// distribute objects eqaully from a single node to all others.
 		/**
 		 * @param[in] communicator MPI communcator.
@@ -250,9 +380,10 @@ namespace quids::mpi {
 
 	private:
 		friend mpi_symbolic_iteration;
-		friend void inline simulate(mpi_it_t &iteration, quids::rule_t const *rule, mpi_it_t &next_iteration, mpi_sy_it_t &symbolic_iteration, MPI_Comm communicator, size_t max_num_object, quids::debug_t mid_step_function);
+		template<class Rule>
+		friend void simulate(mpi_it_t &iteration, Rule const &rule, mpi_it_t &next_iteration, mpi_sy_it_t &symbolic_iteration, context &mpi_context, size_t max_num_object, quids::debug_t mid_step_function);
 
-		void equalize_symbolic(MPI_Comm communicator);
+		void equalize_symbolic(context &mpi_context);
 		void normalize(MPI_Comm communicator, quids::debug_t mid_step_function=[](const char*){});
 
 
@@ -306,7 +437,13 @@ namespace quids::mpi {
 		}
 
 
+		size_t get_object_mem_size(size_t oid) const;
 		size_t get_truncated_mem_size(size_t begin_num_object=0) const;
+		void truncate_mem_size(size_t max_mem_size, quids::debug_t mid_step_function=[](const char*){}) const {
+			quids::iteration::truncate_mem_size(0, max_mem_size, [&](size_t const oid) {
+				return get_object_mem_size(oid);
+			}, mid_step_function);
+		}
 	};
 
 	/// symbolic mpi iteration (computation intermediary)
@@ -340,34 +477,80 @@ namespace quids::mpi {
 
 	private:
 		friend mpi_iteration;
-		friend void inline simulate(mpi_it_t &iteration, quids::rule_t const *rule, mpi_it_t &next_iteration, mpi_sy_it_t &symbolic_iteration, MPI_Comm communicator, size_t max_num_object, quids::debug_t mid_step_function); 
+		template<class Rule>
+		friend void simulate(mpi_it_t &iteration, Rule const &rule, mpi_it_t &next_iteration, mpi_sy_it_t &symbolic_iteration, context &mpi_context, size_t max_num_object, quids::debug_t mid_step_function);
 
-		quids::utils::fast_vector<mag_t> partitioned_mag;
-		quids::utils::fast_vector<size_t> partitioned_hash;
+		/* hash and magnitude of an object, exchanged in a single message. When sharing back, the hash is replaced by the index of the object within its slab */
+		struct exchange_record {
+			size_t hash;
+			mag_t mag;
+		};
+		/* hash marking records whose magnitude was modified by interferences (a genuine hash equal to it only leads to sharing back an unmodified magnitude) */
+		static const size_t modified_hash = (size_t)-1;
 
-		quids::utils::fast_vector<mag_t> mag_buffer;
-		quids::utils::fast_vector<size_t> hash_buffer;
+		quids::utils::fast_vector<exchange_record> partitioned_record;
+
+		quids::utils::fast_vector<exchange_record> record_buffer;
 		quids::utils::fast_vector<int> node_id_buffer;
 
-		void compute_collisions(MPI_Comm communicator, quids::debug_t mid_step_function=[](const char*){});
-		void mpi_resize(size_t size) {
-			#pragma omp parallel sections
-			{
-				#pragma omp section
-				partitioned_mag.resize(size);
+		quids::utils::fast_vector<size_t> encoded_send_buffer;
+		quids::utils::fast_vector<size_t> encoded_receive_buffer;
 
-				#pragma omp section
-				partitioned_hash.resize(size);
+		/* size (in bytes) of an encoded magnitude */
+		static size_t inline encoded_mag_size() {
+			return quantize_magnitude ? sizeof(std::complex<float>) : sizeof(mag_t);
+		}
+		/* size (in words) of the encoding of records sorted by hash, all greater or equal to base */
+		static size_t encoded_size(exchange_record const *begin, exchange_record const *end, size_t base) {
+			size_t size = std::distance(begin, end)*encoded_mag_size();
+			for (auto *record = begin; record < end; base = (record++)->hash)
+				size += quids::utils::varint_size(record->hash - base);
+			return (size + sizeof(size_t) - 1)/sizeof(size_t);
+		}
+		/* encode records sorted by hash, as the varint encoding of the difference between consecutive hashes, followed by the magnitude */
+		static void encode(exchange_record const *begin, exchange_record const *end, size_t base, size_t *out) {
+			uint8_t *out_ = (uint8_t*)out;
+			for (auto *record = begin; record < end; base = (record++)->hash) {
+				out_ = quids::utils::varint_encode(record->hash - base, out_);
+
+				if (quantize_magnitude) {
+					std::complex<float> mag(record->mag.real(), record->mag.imag());
+					std::memcpy(out_, &mag, sizeof(mag));
+				} else
+					std::memcpy(out_, &record->mag, sizeof(mag_t));
+				out_ += encoded_mag_size();
+			}
+		}
+		static void decode(size_t const *in, exchange_record *begin, exchange_record *end, size_t base) {
+			uint8_t const *in_ = (uint8_t const*)in;
+			for (auto *record = begin; record < end; ++record) {
+				size_t delta;
+				in_ = quids::utils::varint_decode(in_, delta);
+				base = record->hash = base + delta;
+
+				if (quantize_magnitude) {
+					std::complex<float> mag;
+					std::memcpy(&mag, in_, sizeof(mag));
+					record->mag = mag;
+				} else
+					std::memcpy(&record->mag, in_, sizeof(mag_t));
+				in_ += encoded_mag_size();
 			}
 		}
+
+		void compute_collisions(MPI_Comm communicator, quids::debug_t mid_step_function=[](const char*){}) {
+			context mpi_context(communicator);
+			compute_collisions(mpi_context, mid_step_function);
+		}
+		void compute_collisions(context &mpi_context, quids::debug_t mid_step_function=[](const char*){});
+		void mpi_resize(size_t size) {
+			partitioned_record.resize(size);
+		}
 		void buffer_resize(size_t size) {
-			#pragma omp parallel sections
+			#pragma omp parallel sections if(!quids::utils::numa_first_touch)
 			{
 				#pragma omp section
-				mag_buffer.resize(size);
-
-				#pragma omp section
-				hash_buffer.resize(size);
+				record_buffer.resize(size);
 
 				#pragma omp section
 				node_id_buffer.resize(size);
@@ -397,7 +580,7 @@ namespace quids::mpi {
 			size_t memory_size = magnitude.size()*symbolic_iteration_memory_size;
 
 			static const size_t mpi_symbolic_iteration_memory_size = MPI_SYMBOLIC_ITERATION_MEMORY_SIZE;
-			memory_size += mag_buffer.size()*mpi_symbolic_iteration_memory_size;
+			memory_size += record_buffer.size()*mpi_symbolic_iteration_memory_size;
 
 			size_t total_size = mpi_symbolic_iteration_memory_size*magnitude.size();
 			MPI_Allreduce(MPI_IN_PLACE, &total_size, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, communicator);
@@ -412,6 +595,21 @@ namespace quids::mpi {
 
 	/// function to apply a dynamic to a wave function distributed accross multiple nodes
 	/**
+	 * @param[in] iteration wavefunction that the dynamic will be applied to.
+	 * @param[in] rule pointer to the dynamic that will be applied (member functions are called through the rule_t vtable if the pointer is of type rule_t*).
+	 * @param[out] next_iteration wave function that will be overwritten to then contained the final wave function.
+	 * @param[out] symbolic_iteration symbolic iteration that will be used.
+	 * @param[in] mpi_context persistent MPI context.
+	 * @param[in] max_num_object maximum number of objects to be kept per node, -1 means no maximum, 0 means automaticaly finding the maximum ammount of objects that can be kept in memory.
+	 * @param[in] mid_step_function debuging function called between steps.
+	 */
+	template<class Rule>
+	void simulate(mpi_it_t &iteration, Rule *rule, mpi_it_t &next_iteration, mpi_sy_it_t &symbolic_iteration, context &mpi_context, size_t max_num_object=0, quids::debug_t mid_step_function=[](const char*){}) {
+		simulate(iteration, *rule, next_iteration, symbolic_iteration, mpi_context, max_num_object, mid_step_function);
+	}
+	/// function to apply a dynamic to a wave function distributed accross multiple nodes
+	/**
+	 * A temporary context is created from the communicator, so a persistent context should be prefered when simulating many steps.
 	 * @param[in] iteration wavefunction that the dynamic will be applied to.
 	 * @param[in] rule dynamic that will be applied.
 	 * @param[out] next_iteration wave function that will be overwritten to then contained the final wave function.
@@ -420,37 +618,60 @@ namespace quids::mpi {
 	 * @param[in] max_num_object maximum number of objects to be kept per node, -1 means no maximum, 0 means automaticaly finding the maximum ammount of objects that can be kept in memory.
 	 * @param[in] mid_step_function debuging function called between steps.
 	 */
-	void simulate(mpi_it_t &iteration, quids::rule_t const *rule, mpi_it_t &next_iteration, mpi_sy_it_t &symbolic_iteration, MPI_Comm communicator, size_t max_num_object=0, quids::debug_t mid_step_function=[](const char*){}) {
-		/* get local size */
-		MPI_Comm localComm;
-		int rank, size, local_size;
-		MPI_Comm_size(communicator, &size);
-		MPI_Comm_rank(communicator, &rank);
-		MPI_Comm_split_type(communicator, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &localComm);
-		MPI_Comm_size(localComm, &local_size);
-
-		const int max_equalize = quids::utils::log_2_upper_bound(size);
+	template<class Rule>
+	void simulate(mpi_it_t &iteration, Rule const &rule, mpi_it_t &next_iteration, mpi_sy_it_t &symbolic_iteration, MPI_Comm communicator, size_t max_num_object=0, quids::debug_t mid_step_function=[](const char*){}) {
+		context mpi_context(communicator);
+		simulate(iteration, rule, next_iteration, symbolic_iteration, mpi_context, max_num_object, mid_step_function);
+	}
+	/// function to apply a dynamic to a wave function distributed accross multiple nodes
+	/**
+	 * @param[in] iteration wavefunction that the dynamic will be applied to.
+	 * @param[in] rule pointer to the dynamic that will be applied (member functions are called through the rule_t vtable if the pointer is of type rule_t*).
+	 * @param[out] next_iteration wave function that will be overwritten to then contained the final wave function.
+	 * @param[out] symbolic_iteration symbolic iteration that will be used.
+	 * @param[in] communicator MPI communcator.
+	 * @param[in] max_num_object maximum number of objects to be kept per node, -1 means no maximum, 0 means automaticaly finding the maximum ammount of objects that can be kept in memory.
+	 * @param[in] mid_step_function debuging function called between steps.
+	 */
+	template<class Rule>
+	void simulate(mpi_it_t &iteration, Rule *rule, mpi_it_t &next_iteration, mpi_sy_it_t &symbolic_iteration, MPI_Comm communicator, size_t max_num_object=0, quids::debug_t mid_step_function=[](const char*){}) {
+		simulate(iteration, *rule, next_iteration, symbolic_iteration, communicator, max_num_object, mid_step_function);
+	}
+	/// function to apply a dynamic to a wave function distributed accross multiple nodes
+	/**
+	 * The rule type is a template parameter, so that member functions of a rule declared "final" can be inlined into the loops over objects.
+	 * @param[in] iteration wavefunction that the dynamic will be applied to.
+	 * @param[in] rule dynamic that will be applied.
+	 * @param[out] next_iteration wave function that will be overwritten to then contained the final wave function.
+	 * @param[out] symbolic_iteration symbolic iteration that will be used.
+	 * @param[in] mpi_context persistent MPI context.
+	 * @param[in] max_num_object maximum number of objects to be kept per node, -1 means no maximum, 0 means automaticaly finding the maximum ammount of objects that can be kept in memory.
+	 * @param[in] mid_step_function debuging function called between steps.
+	 */
+	template<class Rule>
+	void simulate(mpi_it_t &iteration, Rule const &rule, mpi_it_t &next_iteration, mpi_sy_it_t &symbolic_iteration, context &mpi_context, size_t max_num_object, quids::debug_t mid_step_function) {
+		const int max_equalize = quids::utils::log_2_upper_bound(mpi_context.size);
 
 
 
 		
 
 
-		if (size == 1)
+		if (mpi_context.size == 1)
 			return quids::simulate(iteration, rule, next_iteration, symbolic_iteration, max_num_object, mid_step_function);
 
 		/* equalize objects */
 		if (!equalize_children) {
 			mid_step_function("equalize_object");
-			float previous_diff, avg_n_object = iteration.get_avg_num_object_per_task(communicator);
+			float previous_diff, avg_n_object = iteration.get_avg_num_object_per_task(mpi_context);
 			for (int i = 0; i < max_equalize; ++i) {
 				/* check for condition */
-				size_t max_n_object = iteration.get_max_num_object_per_task(communicator);
+				size_t max_n_object = iteration.get_max_num_object_per_task(mpi_context);
 				float diff = (float)max_n_object - avg_n_object;
 				float inbalance = diff/max_n_object;
 
 				// debug: 
-				if (rank == 0)
+				if (mpi_context.rank == 0)
 					std::cerr << "\ti=" << i << "/" << max_equalize << "\tmax=" << max_n_object << ", avg=" << avg_n_object << ", inbalance=" << inbalance << "\n";
 
 				if (max_n_object < min_equalize_size ||
@@ -459,7 +680,7 @@ namespace quids::mpi {
 					break;
 
 				/* actually equalize */
-				iteration.equalize(communicator);
+				iteration.equalize(mpi_context);
 
 				previous_diff = diff;
 			}
@@ -474,16 +695,16 @@ namespace quids::mpi {
 		/* equalize symbolic objects */
 		if (equalize_children) {
 			mid_step_function("equalize_child");
-			float previous_diff, avg_n_child = iteration.get_avg_num_symbolic_object_per_task(communicator);
+			float previous_diff, avg_n_child = iteration.get_avg_num_symbolic_object_per_task(mpi_context);
 			for (int i = 0; i < max_equalize; ++i) {
 				/* check for condition */
-				size_t max_n_object = iteration.get_max_num_object_per_task(communicator);
-				size_t max_n_child = iteration.get_max_num_symbolic_object_per_task(communicator);
+				size_t max_n_object = iteration.get_max_num_object_per_task(mpi_context);
+				size_t max_n_child = iteration.get_max_num_symbolic_object_per_task(mpi_context);
 				float diff = (float)max_n_child - avg_n_child;
 				float inbalance = diff/max_n_child;
 
 				// debug: 
-				if (rank == 0)
+				if (mpi_context.rank == 0)
 					std::cerr << "\ti=" << i << "/" << max_equalize << "\tmax=" << max_n_child << ", avg=" << avg_n_child << ", inbalance=" << inbalance << "\n";
 
 				if (max_n_object < min_equalize_size ||
@@ -492,7 +713,7 @@ namespace quids::mpi {
 					break;
 
 				/* actually equalize */
-				iteration.equalize_symbolic(communicator);
+				iteration.equalize_symbolic(mpi_context);
 				iteration.truncated_num_object = iteration.num_object;
 
 				previous_diff = diff;
@@ -509,32 +730,22 @@ namespace quids::mpi {
 		mid_step_function("truncate_symbolic");
 		if (max_num_object == 0) {
 			/* available memory */
-			size_t next_iteration_mem = next_iteration.get_mem_size(localComm);
-			size_t previous_iteration_mem = iteration.get_mem_size(localComm);
+			size_t next_iteration_mem = next_iteration.get_mem_size(mpi_context.local_communicator);
+			size_t previous_iteration_mem = iteration.get_mem_size(mpi_context.local_communicator);
 			if (next_iteration_mem > previous_iteration_mem) {
 				next_iteration_mem = (1 - equalize_factor)*next_iteration_mem + equalize_factor*previous_iteration_mem;
 			}
-			size_t avail_memory = next_iteration_mem + symbolic_iteration.get_mem_size(localComm) + quids::utils::get_free_mem();
+			size_t avail_memory = next_iteration_mem + symbolic_iteration.get_mem_size(mpi_context.local_communicator) + quids::utils::get_free_mem();
+			if (symbolic_iteration.is_file_backed() || next_iteration.is_file_backed())
+				avail_memory += quids::utils::get_free_disk_space();
 			size_t non_avail_memory = previous_iteration_mem;
-			size_t target_memory = ((avail_memory + non_avail_memory)*(1 - quids::safety_margin) - non_avail_memory)/local_size;
-
-			/* actually truncate by binary search */
-			if (iteration.get_truncated_mem_size() > target_memory) {
-				size_t begin = 0, end = iteration.num_object;
-				while (end > begin + 1) {
-					size_t middle = (end + begin) / 2;
-					iteration.truncate(begin, middle, mid_step_function);
-
-					size_t used_memory = iteration.get_truncated_mem_size(begin);
-					if (used_memory < target_memory) {
-						target_memory -= used_memory;
-						begin = middle;
-					} else
-						end = middle;
-				}
-			}
+			size_t target_memory = ((avail_memory + non_avail_memory)*(1 - quids::safety_margin) - non_avail_memory)/mpi_context.local_size;
+
+			/* actually truncate */
+			if (iteration.get_truncated_mem_size() > target_memory)
+				iteration.truncate_mem_size(target_memory, mid_step_function);
 		} else
-			iteration.truncate(0, max_num_object/local_size, mid_step_function);
+			iteration.truncate(0, max_num_object/mpi_context.local_size, mid_step_function);
 
 
 		/* downsize if needed */
@@ -544,76 +755,73 @@ namespace quids::mpi {
 			size_t next_object_size = iteration.truncated_num_object*iteration.get_object_length()/iteration.num_object;
 			if (next_object_size < next_iteration.objects.size())
 				next_iteration.allocate(next_object_size);
+
+			/* actually free the memory of next_iteration that was counted as available when truncating */
+			if (iteration.truncated_num_object < iteration.num_object)
+				next_iteration.shrink_to_fit();
 		}
 
 
 		/* rest of the simulation */
-		iteration.generate_symbolic_iteration(rule, symbolic_iteration, mid_step_function);
-		symbolic_iteration.compute_collisions(communicator, mid_step_function);
+		iteration.generate_symbolic_iteration(rule, symbolic_iteration, 0, iteration.truncated_num_object, mid_step_function);
+		symbolic_iteration.compute_collisions(mpi_context, mid_step_function);
 		symbolic_iteration.next_iteration_num_object = symbolic_iteration.num_object_after_interferences;
 
 
 		/* prepare truncate */
 		mid_step_function("truncate - prepare");
-		symbolic_iteration.prepare_truncate(mid_step_function);
+		symbolic_iteration.prepare_truncate(iteration.num_step, mid_step_function);
 
 
 		/* second max_num_object */
 		mid_step_function("truncate");
 		if (max_num_object == 0) {
 			/* available memory */
-			size_t next_iteration_mem = next_iteration.get_mem_size(localComm);
-			size_t previous_iteration_mem = iteration.get_mem_size(localComm);
+			size_t next_iteration_mem = next_iteration.get_mem_size(mpi_context.local_communicator);
+			size_t previous_iteration_mem = iteration.get_mem_size(mpi_context.local_communicator);
 			if (next_iteration_mem > previous_iteration_mem) {
 				next_iteration_mem = (1 - equalize_factor)*next_iteration_mem + equalize_factor*previous_iteration_mem;
 			}
 			size_t avail_memory = next_iteration_mem + quids::utils::get_free_mem();
-			size_t non_avail_memory = previous_iteration_mem + symbolic_iteration.get_mem_size(localComm);
-			size_t target_memory = ((avail_memory + non_avail_memory)*(1 - quids::safety_margin) - non_avail_memory)/local_size;
-
-			/* actually truncate by binary search */
-			if (symbolic_iteration.get_truncated_mem_size() > target_memory) {
-				size_t begin = 0, end = symbolic_iteration.num_object_after_interferences;
-				while (end > begin + 1) {
-					size_t middle = (end + begin) / 2;
-					symbolic_iteration.truncate(begin, middle, mid_step_function);
-
-					size_t used_memory = symbolic_iteration.get_truncated_mem_size(begin);
-					if (used_memory < target_memory) {
-						target_memory -= used_memory;
-						begin = middle;
-					} else
-						end = middle;
-				}
-			}
+			if (next_iteration.is_file_backed())
+				avail_memory += quids::utils::get_free_disk_space();
+			size_t non_avail_memory = previous_iteration_mem + symbolic_iteration.get_mem_size(mpi_context.local_communicator);
+			size_t target_memory = ((avail_memory + non_avail_memory)*(1 - quids::safety_margin) - non_avail_memory)/mpi_context.local_size;
+
+			/* actually truncate */
+			if (symbolic_iteration.get_truncated_mem_size() > target_memory)
+				symbolic_iteration.truncate_mem_size(target_memory, mid_step_function);
 		} else
-			symbolic_iteration.truncate(0, max_num_object/local_size, mid_step_function);
+			symbolic_iteration.truncate(0, max_num_object/mpi_context.local_size, mid_step_function);
 
 
 		/* finalize simulation */
 		symbolic_iteration.finalize(rule, iteration, next_iteration, mid_step_function);
-		next_iteration.normalize(communicator, mid_step_function);
-
-		MPI_Comm_free(&localComm);
+		next_iteration.normalize(mpi_context, mid_step_function);
 	}
 
 	/*
-	get the truncated memory size
+	get the memory size of an object and its children
 	*/
-	size_t mpi_iteration::get_truncated_mem_size(size_t begin_num_object) const {
+	size_t mpi_iteration::get_object_mem_size(size_t oid) const {
 		static const size_t iteration_memory_size = ITERATION_MEMORY_SIZE;
 
 		static const float hash_map_size = HASH_MAP_OVERHEAD*2*sizeof(size_t);
 		static const size_t symbolic_iteration_memory_size = SYMBOLIC_ITERATION_MEMORY_SIZE + MPI_SPECIFIC_SYMBOLIC_ITERATION_MEMORY_SIZE;
 		static const size_t mpi_symbolic_iteration_memory_size = MPI_SYMBOLIC_ITERATION_MEMORY_SIZE;
 
-		size_t mem_size = iteration_memory_size*(truncated_num_object - begin_num_object);
-		for (size_t i = begin_num_object; i < truncated_num_object; ++i) {
-			size_t oid = truncated_oid[i];
+		return iteration_memory_size + object_begin[oid + 1] - object_begin[oid] +
+			(size_t)(num_childs[oid]*(symbolic_iteration_memory_size + mpi_symbolic_iteration_memory_size + hash_map_size));
+	}
 
-			mem_size += object_begin[oid + 1] - object_begin[oid];
-			mem_size += num_childs[oid]*(symbolic_iteration_memory_size + mpi_symbolic_iteration_memory_size + hash_map_size);
-		}
+	/*
+	get the truncated memory size
+	*/
+	size_t mpi_iteration::get_truncated_mem_size(size_t begin_num_object) const {
+		size_t mem_size = 0;
+		#pragma omp parallel for reduction(+:mem_size)
+		for (size_t i = begin_num_object; i < truncated_num_object; ++i)
+			mem_size += get_object_mem_size(truncated_oid[i]);
 
 		return mem_size*quids::utils::upsize_policy;
 	}
@@ -621,18 +829,14 @@ namespace quids::mpi {
 	/*
 	distributed interference function
 	*/
-	void mpi_symbolic_iteration::compute_collisions(MPI_Comm communicator, quids::debug_t mid_step_function) {
-		int size, rank;
-		MPI_Comm_size(communicator, &size);
-		MPI_Comm_rank(communicator, &rank);
+	void mpi_symbolic_iteration::compute_collisions(context &mpi_context, quids::debug_t mid_step_function) {
+		MPI_Comm const communicator = mpi_context;
+		int const size = mpi_context.size, rank = mpi_context.rank;
 
 		if (size == 1)
-			return quids::symbolic_iteration::compute_collisions(mid_step_function);
+			return quids::symbolic_iteration::compute_collisions(0, mid_step_function);
 
-		int num_threads;
-		#pragma omp parallel
-		#pragma omp single
-		num_threads = omp_get_num_threads();
+		int const num_threads = mpi_context.num_threads;
 
 		int const n_segment = size*num_threads;
 		int const num_bucket = quids::utils::nearest_power_of_two(load_balancing_bucket_per_thread*n_segment);
@@ -642,18 +846,35 @@ namespace quids::mpi {
 		std::vector<size_t> partition_begin(num_bucket + 1);
 		std::vector<size_t> total_partition_begin(num_bucket + 1);
 
-		std::vector<int> local_disp(n_segment + 1);
-		std::vector<int> local_count(n_segment);
-		std::vector<int> global_disp(n_segment + 1, 0);
-		std::vector<int> global_count(n_segment);
+		/* count and displacement buffers are kept by the context */
+		auto &local_disp = mpi_context.local_disp, &local_count = mpi_context.local_count;
+		auto &global_disp = mpi_context.global_disp, &global_count = mpi_context.global_count;
+		auto &modified_count = mpi_context.modified_count;
+
+		auto &local_word_disp = mpi_context.local_word_disp, &local_word_count = mpi_context.local_word_count;
+		auto &global_word_disp = mpi_context.global_word_disp, &global_word_count = mpi_context.global_word_count;
 
-		std::vector<int> send_disp(size + 1);
-		std::vector<int> send_count(size);
-		std::vector<int> receive_disp(size + 1);
-		std::vector<int> receive_count(size);
+		auto &send_disp = mpi_context.send_disp, &send_count = mpi_context.send_count;
+		auto &receive_disp = mpi_context.receive_disp, &receive_count = mpi_context.receive_count;
+
+		/* !!!!!!!!!!!!!!!!
+		local aggregation
+		!!!!!!!!!!!!!!!! */
+		size_t num_local_object = num_object;
+		if (local_aggregation && num_object > 0) {
+			/* eliminate local duplicates, so that only locally unique objects are sent (duplicates are left with a zero magnitude) */
+			eliminate_duplicates(0, mid_step_function);
+
+			mid_step_function("compute_collisions - prepare");
+			size_t* partitioned_it = __gnu_parallel::partition(&next_oid[0], &next_oid[0] + num_object,
+				[&](size_t const &oid) {
+					return magnitude[oid] != (stored_mag_t)0;
+				});
+			num_local_object = std::distance(&next_oid[0], partitioned_it);
+		}
 
 		mid_step_function("compute_collisions - prepare");
-		mpi_resize(num_object);
+		mpi_resize(num_local_object);
 
 
 
@@ -662,19 +883,26 @@ namespace quids::mpi {
 		/* !!!!!!!!!!!!!!!!
 		partition
 		!!!!!!!!!!!!!!!! */
-		quids::utils::parallel_generalized_partition_from_iota(&next_oid[0], &next_oid[0] + num_object, 0,
-			partition_begin.begin(), partition_begin.end(),
-			[&](size_t const oid) {
-				return hash[oid] >> offset;
-			});
+		if (local_aggregation) {
+			quids::utils::parallel_generalized_partition(&next_oid[0], &next_oid[0] + num_local_object, &next_oid_partitioner_buffer[0],
+				partition_begin.begin(), partition_begin.end(),
+				[&](size_t const oid) {
+					return hash[oid] >> offset;
+				});
+		} else
+			quids::utils::parallel_generalized_partition_from_iota(&next_oid[0], &next_oid[0] + num_object, 0,
+				partition_begin.begin(), partition_begin.end(),
+				[&](size_t const oid) {
+					return hash[oid] >> offset;
+				});
 
-		/* generate partitioned hash */
+		/* generate partitioned records */
 		#pragma omp parallel for
-		for (size_t id = 0; id < num_object; ++id) {
+		for (size_t id = 0; id < num_local_object; ++id) {
 			size_t oid = next_oid[id];
 
-			partitioned_mag[id] = magnitude[oid];
-			partitioned_hash[id] = hash[oid];
+			partitioned_record[id].hash = hash[oid];
+			partitioned_record[id].mag  = magnitude[oid];
 		}
 
 
@@ -708,6 +936,42 @@ namespace quids::mpi {
 			local_count[i - 1] = local_disp[i] - local_disp[i - 1];
 		}
 
+		/* each segment covers a range of buckets, so its hashes are greater or equal to the lower bound of the range */
+		const auto segment_base = [&](int const segment) {
+			return (size_t)load_balancing_begin[segment] << offset;
+		};
+
+		if (compress_exchange) {
+			/* sort each segment by hash, and compute its encoded size */
+			#pragma omp parallel
+			{
+				std::vector<std::pair<size_t, size_t>> sorted_hash, sort_buffer;
+
+				#pragma omp for schedule(dynamic)
+				for (int segment = 0; segment < n_segment; ++segment) {
+					size_t begin = local_disp[segment], end = local_disp[segment + 1];
+
+					sorted_hash.resize(end - begin);
+					sort_buffer.resize(end - begin);
+					for (size_t id = begin; id < end; ++id)
+						sorted_hash[id - begin] = {partitioned_record[id].hash, next_oid[id]};
+					quids::utils::radix_sort_by_key(sorted_hash.data(), sorted_hash.data() + (end - begin), sort_buffer.data());
+
+					for (size_t id = begin; id < end; ++id) {
+						size_t oid = sorted_hash[id - begin].second;
+
+						next_oid[id] = oid;
+						partitioned_record[id].hash = sorted_hash[id - begin].first;
+						partitioned_record[id].mag  = magnitude[oid];
+					}
+
+					local_word_count[segment] = encoded_size(&partitioned_record[begin], &partitioned_record[end], segment_base(segment));
+				}
+			}
+
+			std::partial_sum(&local_word_count[0], &local_word_count[0] + n_segment, &local_word_disp[1]);
+		}
+
 
 
 
@@ -720,9 +984,31 @@ namespace quids::mpi {
 		MPI_Alltoall(&local_count [0], num_threads, MPI_INT, 
 					 &global_count[0], num_threads, MPI_INT, communicator);
 
+		MPI_Request word_count_request = MPI_REQUEST_NULL;
+		if (compress_exchange)
+			MPI_Ialltoall(&local_word_count [0], num_threads, MPI_INT,
+			              &global_word_count[0], num_threads, MPI_INT, communicator, &word_count_request);
+
 		mid_step_function("compute_collisions - prepare");
 		std::partial_sum(&global_count[0], &global_count[0] + n_segment, &global_disp[1]);
 
+		if (compress_exchange) {
+			/* encode segments, while the encoded sizes are being shared */
+			encoded_send_buffer.resize(local_word_disp[n_segment]);
+
+			#pragma omp parallel for schedule(dynamic)
+			for (int segment = 0; segment < n_segment; ++segment)
+				encode(&partitioned_record[local_disp[segment]], &partitioned_record[local_disp[segment + 1]], segment_base(segment),
+					&encoded_send_buffer[local_word_disp[segment]]);
+
+			mid_step_function("compute_collisions - com");
+			MPI_Wait(&word_count_request, MPI_STATUS_IGNORE);
+
+			mid_step_function("compute_collisions - prepare");
+			std::partial_sum(&global_word_count[0], &global_word_count[0] + n_segment, &global_word_disp[1]);
+			encoded_receive_buffer.resize(global_word_disp[n_segment]);
+		}
+
 		/* recompute send and receive count and disp */
 		send_disp[0] = 0; receive_disp[0] = 0;
 		for (int i = 1; i <= size; ++i) {
@@ -736,12 +1022,30 @@ namespace quids::mpi {
 		/* resize */
 		buffer_resize(receive_disp[size]);
 
-		/* actualy share partition */
+		/* actualy share partition: one slab per node, so that each slab can be inserted as soon as it is received.
+		Slabs are sent in the order in which the receiving node inserts them (starting from its own slab) */
 		mid_step_function("compute_collisions - com");
-		MPI_Alltoallv(&partitioned_hash[0], &send_count[0],    &send_disp[0],    MPI_UNSIGNED_LONG_LONG,
-			          &hash_buffer[0],      &receive_count[0], &receive_disp[0], MPI_UNSIGNED_LONG_LONG, communicator);
-		MPI_Alltoallv(&partitioned_mag[0],  &send_count[0],    &send_disp[0],    mag_MPI_Datatype,
-			          &mag_buffer[0],       &receive_count[0], &receive_disp[0], mag_MPI_Datatype,       communicator);
+		MPI_Datatype const record_MPI_Datatype = utils::get_mpi_record_datatype<exchange_record>();
+		auto &receive_requests = mpi_context.receive_requests;
+		auto &send_requests = mpi_context.send_requests;
+		for (int j = 1; j < size; ++j) {
+			const int node_id = (rank + j)%size;
+			if (compress_exchange) {
+				int word_count = global_word_disp[(node_id + 1)*num_threads] - global_word_disp[node_id*num_threads];
+				MPI_Irecv(&encoded_receive_buffer[global_word_disp[node_id*num_threads]], word_count, MPI_UNSIGNED_LONG_LONG, node_id, 0, communicator, &receive_requests[node_id]);
+			} else
+				MPI_Irecv(&record_buffer[receive_disp[node_id]], receive_count[node_id], record_MPI_Datatype, node_id, 0, communicator, &receive_requests[node_id]);
+		}
+		for (int j = 1; j < size; ++j) {
+			const int node_id = (rank - j + size)%size;
+			if (compress_exchange) {
+				int word_count = local_word_disp[(node_id + 1)*num_threads] - local_word_disp[node_id*num_threads];
+				MPI_Isend(&encoded_send_buffer[local_word_disp[node_id*num_threads]], word_count, MPI_UNSIGNED_LONG_LONG, node_id, 0, communicator, &send_requests[node_id]);
+			} else
+				MPI_Isend(&partitioned_record[send_disp[node_id]], send_count[node_id], record_MPI_Datatype, node_id, 0, communicator, &send_requests[node_id]);
+		}
+		PROFILE_OBJECTS(num_local_object, receive_disp[size]);
+		PROFILE_BYTES(compress_exchange ? local_word_disp[n_segment]*sizeof(size_t) : num_local_object*sizeof(exchange_record));
 
 
 
@@ -752,14 +1056,25 @@ namespace quids::mpi {
 		compute-collision
 		!!!!!!!!!!!!!!!! */
 		mid_step_function("compute_collisions - prepare");
-		/* prepare node_id buffer */
+		/* copy local slab and prepare node_id buffer, while other slabs are being received */
+		if (compress_exchange) {
+			std::copy(&encoded_send_buffer[local_word_disp[rank*num_threads]], &encoded_send_buffer[local_word_disp[(rank + 1)*num_threads]],
+				&encoded_receive_buffer[global_word_disp[rank*num_threads]]);
+		} else
+			std::copy(&partitioned_record[send_disp[rank]], &partitioned_record[send_disp[rank + 1]], &record_buffer[receive_disp[rank]]);
 		for (int node = 0; node < size; ++node)
 			std::fill(&node_id_buffer[0] + receive_disp[node],
 					  &node_id_buffer[0] + receive_disp[node + 1],
 					  node);
 
-		mid_step_function("compute_collisions - insert");
-		#pragma omp parallel
+#ifdef FLAT_COLLISION_TABLE
+		reserve_collision_tables(num_threads);
+#endif
+		/* each thread inserts the segments of its own thread_id, so exactly as many threads as cached by the context are required */
+		if (omp_get_thread_limit() < num_threads)
+			throw std::runtime_error("the OpenMP thread limit is lower than the number of threads of the mpi context !!");
+
+		#pragma omp parallel num_threads(num_threads)
 		{
 			// work stealing oracle
 			std::vector<size_t> global_num_object_after_interferences(size, 0);
@@ -780,34 +1095,53 @@ namespace quids::mpi {
 			};
 
 			int const thread_id = omp_get_thread_num();
-			robin_hood::unordered_map<size_t, size_t> elimination_map;
 
 			/* compute total_size */
-			size_t total_size = 0, max_count = 0;
-			for (int node_id = 0; node_id < size; ++node_id) {
-				size_t this_size = global_count[node_id*num_threads + thread_id];
-
-				total_size +=          this_size;
-				max_count   = std::max(this_size, max_count);
-			}
+			size_t total_size = 0;
+			for (int node_id = 0; node_id < size; ++node_id)
+				total_size += global_count[node_id*num_threads + thread_id];
+#ifdef FLAT_COLLISION_TABLE
+			auto &elimination_map = *collision_tables[thread_id];
+			elimination_map.reset(total_size);
+#else
+			robin_hood::unordered_map<size_t, size_t> elimination_map;
 			elimination_map.reserve(total_size);
+#endif
 
-			/* insert into hashmap */
-			for (size_t i = 0; GRANULARITY*i < max_count; ++i)
-				for (int j = 0; j < size; ++j) {
-					const int node_id = (rank + j)%size;
+			/* insert into hashmap, slab by slab */
+			for (int j = 0; j < size; ++j) {
+				const int node_id = (rank + j)%size;
 
-					if (node_id >= size)
-						throw;
+				/* only the time spent waiting for a slab is accounted as communication, the rest overlaps with insertion */
+				#pragma omp master
+				{
+					mid_step_function("compute_collisions - com");
+					MPI_Wait(&receive_requests[node_id], MPI_STATUS_IGNORE);
+					mid_step_function("compute_collisions - insert");
+				}
+				#pragma omp barrier
+
+				const size_t slab_begin = global_disp[node_id*num_threads + thread_id    ];
+				const size_t slab_end   = global_disp[node_id*num_threads + thread_id + 1];
 
-					const size_t begin =                i*GRANULARITY        + global_disp[node_id*num_threads + thread_id    ];
-					const size_t end   = std::min(begin + GRANULARITY, (size_t)global_disp[node_id*num_threads + thread_id + 1]);
+				/* each thread decodes the segment it inserts */
+				if (compress_exchange)
+					decode(&encoded_receive_buffer[global_word_disp[node_id*num_threads + thread_id]],
+						&record_buffer[slab_begin], &record_buffer[slab_end], segment_base(rank*num_threads + thread_id));
 
+				for (size_t begin = slab_begin; begin < slab_end; begin += GRANULARITY) {
+					/* drive the progress of pending communications */
+					if (thread_id == 0) {
+						int flag;
+						MPI_Testall(size, &receive_requests[0], &flag, MPI_STATUSES_IGNORE);
+					}
+
+					const size_t end = std::min(begin + GRANULARITY, slab_end);
 					for (size_t oid = begin; oid < end; ++oid) {
 						++global_num_object_after_interferences[node_id];
 
 						/* accessing key */
-						auto [it, unique] = elimination_map.insert({hash_buffer[oid], oid});
+						auto [it, unique] = elimination_map.insert({record_buffer[oid].hash, oid});
 						if (!unique) {
 							const size_t other_oid = it->second;
 							const int other_node_id = node_id_buffer[other_oid];
@@ -817,17 +1151,39 @@ namespace quids::mpi {
 								it->second = oid;
 
 								/* add probabilities */
-								mag_buffer[oid]      += mag_buffer[other_oid];
-								mag_buffer[other_oid] = 0;
+								record_buffer[oid].mag      += record_buffer[other_oid].mag;
+								record_buffer[other_oid].mag = 0;
 							} else {
 								/* if it exist add the probabilities */
-								mag_buffer[other_oid] += mag_buffer[oid];
-								mag_buffer[oid]        = 0;
+								record_buffer[other_oid].mag += record_buffer[oid].mag;
+								record_buffer[oid].mag        = 0;
 							}
+
+							/* hashes are no longer needed once inserted, so they are used to mark modified magnitudes */
+							record_buffer[oid].hash = record_buffer[other_oid].hash = modified_hash;
 						}
 					}
 				}
+			}
+
+			/* compact modified magnitudes in place, at the begining of each segment, with their index within their slab */
+			#pragma omp barrier
+			for (int node_id = 0; node_id < size; ++node_id) {
+				const size_t segment_begin = global_disp[node_id*num_threads + thread_id    ];
+				const size_t segment_end   = global_disp[node_id*num_threads + thread_id + 1];
+
+				size_t modified_end = segment_begin;
+				for (size_t oid = segment_begin; oid < segment_end; ++oid)
+					if (record_buffer[oid].hash == modified_hash) {
+						record_buffer[modified_end].hash = oid - receive_disp[node_id];
+						record_buffer[modified_end].mag  = record_buffer[oid].mag;
+						++modified_end;
+					}
+
+				modified_count[node_id*num_threads + thread_id] = modified_end - segment_begin;
+			}
 		}
+		MPI_Waitall(size, &send_requests[0], MPI_STATUSES_IGNORE);
 
 
 
@@ -838,15 +1194,48 @@ namespace quids::mpi {
 		/* !!!!!!!!!!!!!!!!
 		share-back
 		!!!!!!!!!!!!!!!! */
-		mid_step_function("compute_collisions - com");
-		MPI_Alltoallv(&mag_buffer[0],      &receive_count[0], &receive_disp[0], mag_MPI_Datatype,
-			          &partitioned_mag[0], &send_count[0],    &send_disp[0],    mag_MPI_Datatype, communicator);
+		mid_step_function("compute_collisions - prepare");
+		/* describe the modified magnitudes of each slab (scattered accross segments) by an indexed datatype */
+		auto &share_back_datatypes = mpi_context.share_back_datatypes;
+		auto &share_back_send_count = mpi_context.share_back_send_count, &share_back_receive_count = mpi_context.share_back_receive_count;
+		std::fill(share_back_send_count.begin(), share_back_send_count.end(), 0);
+		for (int node_id = 0; node_id < size; ++node_id) {
+			std::vector<int> block_disp(num_threads);
+			for (int thread_id = 0; thread_id < num_threads; ++thread_id) {
+				block_disp[thread_id] = global_disp[node_id*num_threads + thread_id] - receive_disp[node_id];
+				share_back_send_count[node_id] += modified_count[node_id*num_threads + thread_id];
+			}
 
-		/* un-partition magnitude */
-		mid_step_function("compute_collisions - finalize");
-		#pragma omp parallel for
-		for (size_t id = 0; id < num_object; ++id)
-			magnitude[next_oid[id]] = partitioned_mag[id];
+			MPI_Type_indexed(num_threads, &modified_count[node_id*num_threads], &block_disp[0], record_MPI_Datatype, &share_back_datatypes[node_id]);
+			MPI_Type_commit(&share_back_datatypes[node_id]);
+		}
+
+		/* only share back modified magnitudes (the other ones are unchanged) */
+		mid_step_function("compute_collisions - com");
+		MPI_Alltoall(&share_back_send_count[0],    1, MPI_INT,
+		             &share_back_receive_count[0], 1, MPI_INT, communicator);
+		for (int node_id = 0; node_id < size; ++node_id) {
+			MPI_Irecv(&partitioned_record[send_disp[node_id]], share_back_receive_count[node_id], record_MPI_Datatype, node_id, 1, communicator, &receive_requests[node_id]);
+			MPI_Isend(&record_buffer[receive_disp[node_id]], 1, share_back_datatypes[node_id], node_id, 1, communicator, &send_requests[node_id]);
+		}
+		PROFILE_OBJECTS(receive_disp[size], num_local_object);
+		PROFILE_BYTES(std::accumulate(share_back_send_count.begin(), share_back_send_count.end(), (size_t)0)*sizeof(exchange_record));
+
+		/* un-partition modified magnitudes, slab by slab as they are received */
+		for (int i = 0; i < size; ++i) {
+			mid_step_function("compute_collisions - com");
+			int node_id;
+			MPI_Waitany(size, &receive_requests[0], &node_id, MPI_STATUS_IGNORE);
+
+			mid_step_function("compute_collisions - finalize");
+			exchange_record const *slab_begin = &partitioned_record[send_disp[node_id]];
+			#pragma omp parallel for
+			for (int id = 0; id < share_back_receive_count[node_id]; ++id)
+				magnitude[next_oid[send_disp[node_id] + slab_begin[id].hash]] = slab_begin[id].mag;
+		}
+		MPI_Waitall(size, &send_requests[0], MPI_STATUSES_IGNORE);
+		for (auto &datatype : share_back_datatypes)
+			MPI_Type_free(&datatype);
 
 
 
@@ -857,9 +1246,13 @@ namespace quids::mpi {
 		/* !!!!!!!!!!!!!!!!
 		partition
 		!!!!!!!!!!!!!!!! */
+		/* cache probabilities (reused by prepare_truncate) */
+		quids::utils::compute_norms(&magnitude[0], &magnitude[0] + num_object, &random_selector[0]);
+
 		size_t* partitioned_it = __gnu_parallel::partition(&next_oid[0], &next_oid[0] + num_object,
 			[&](size_t const &oid) {
-				return std::norm(magnitude[oid]) > tolerance;
+				/* compared in PROBA_TYPE, as the cached (float) probability can underflow a small tolerance */
+				return std::norm((mag_t)magnitude[oid]) > tolerance;
 			});
 		num_object_after_interferences = std::distance(&next_oid[0], partitioned_it);
 	}
@@ -876,18 +1269,15 @@ namespace quids::mpi {
 		node_total_proba = 0;
 		total_proba = 0;
 
-		#pragma omp parallel for reduction(+:node_total_proba)
-		for (size_t oid = 0; oid < num_object; ++oid)
-			node_total_proba += std::norm(magnitude[oid]);
+		node_total_proba = quids::utils::norm_sum<PROBA_TYPE>(&magnitude[0], &magnitude[0] + num_object);
 
 		/* accumulate probabilities on the master node */
 		MPI_Allreduce(&node_total_proba, &total_proba, 1, Proba_MPI_Datatype, MPI_SUM, communicator);
 		PROBA_TYPE normalization_factor = std::sqrt(total_proba);
 
+		/* multiplied in PROBA_TYPE, even if magnitudes are stored with a lower precision */
 		if (normalization_factor != 1)
-			#pragma omp parallel for 
-			for (size_t oid = 0; oid < num_object; ++oid)
-				magnitude[oid] /= normalization_factor;
+			quids::utils::scale<PROBA_TYPE>(&magnitude[0], &magnitude[0] + num_object, 1/normalization_factor);
 
 		node_total_proba /= total_proba;
 
@@ -900,15 +1290,11 @@ namespace quids::mpi {
 	/*
 	equalize the number of objects across nodes
 	*/
-	void mpi_iteration::equalize(MPI_Comm communicator) {
+	void mpi_iteration::equalize(context &mpi_context) {
 		MPI_Request request = MPI_REQUEST_NULL;
 
-		MPI_Comm localComm;
-		int rank, size, local_size;
-		MPI_Comm_size(communicator, &size);
-		MPI_Comm_rank(communicator, &rank);
-		MPI_Comm_split_type(communicator, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &localComm);
-		MPI_Comm_size(localComm, &local_size);
+		MPI_Comm const communicator = mpi_context, localComm = mpi_context.local_communicator;
+		int const rank = mpi_context.rank, size = mpi_context.size, local_size = mpi_context.local_size;
 
 		int this_pair_id;
 		if (rank == 0) {
@@ -960,15 +1346,11 @@ namespace quids::mpi {
 	/*
 	equalize symbolic object across nodes
 	*/
-	void mpi_iteration::equalize_symbolic(MPI_Comm communicator) {
+	void mpi_iteration::equalize_symbolic(context &mpi_context) {
 		MPI_Request request = MPI_REQUEST_NULL;
 
-		MPI_Comm localComm;
-		int rank, size, local_size;
-		MPI_Comm_size(communicator, &size);
-		MPI_Comm_rank(communicator, &rank);
-		MPI_Comm_split_type(communicator, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &localComm);
-		MPI_Comm_size(localComm, &local_size);
+		MPI_Comm const communicator = mpi_context, localComm = mpi_context.local_communicator;
+		int const rank = mpi_context.rank, size = mpi_context.size, local_size = mpi_context.local_size;
 
 		/* compute the number of symbolic objects */
 		size_t num_symbolic_object = child_begin[num_object];
@@ -1037,6 +1419,9 @@ namespace quids::mpi {
 		MPI_Comm_size(communicator, &size);
 		MPI_Comm_rank(communicator, &rank);
 
+		/* all nodes share the same random streams */
+		MPI_Bcast(&num_step, 1, MPI_UNSIGNED_LONG_LONG, node_id, communicator);
+
 		size_t initial_num_object = num_object;
 		if (rank == node_id) {
 			for (int node = 1; node < size; ++node) {
@@ -119,9 +119,12 @@ namespace quids::rules::qcgd {
 			}
 		}
 
+		/* Zobrist key of the left (side=0) or right (side=1) particle of a node */
+		size_t inline particle_key(int node, bool side) {
+			return quids::utils::zobrist_key(node, 1 + side);
+		}
+
 		size_t inline hash_graph(char const *object_begin) {
-			size_t left_hash = 0;
-			size_t right_hash = 0;
 			size_t name_hash = 0;
 
 			bool const *left_ = left(object_begin);
@@ -130,19 +133,38 @@ namespace quids::rules::qcgd {
 			auto const *node_name_ = node_name(object_begin);
 
 			uint16_t const num_nodes_ = num_nodes(object_begin);
+			for (auto i = 0; i < num_nodes_; ++i)
+				utils::hash_combine(name_hash, node_name_[node_begin[i]].hash);
+
+			/* particles are hashed separately from names, so that moving particles only changes a few keys */
+			size_t hash = name_hash;
 			for (auto i = 0; i < num_nodes_; ++i) {
 				if (left_[i])
-					utils::hash_combine(left_hash, i);
+					hash ^= particle_key(i, 0);
 
 				if (right_[i])
-					utils::hash_combine(right_hash, i);
+					hash ^= particle_key(i, 1);
+			}
 
-				utils::hash_combine(name_hash, node_name_[node_begin[i]].hash);
+			return hash;
+		}
+
+		size_t inline hash_graph_update(char const *parent_begin, size_t const parent_hash, char const *child_begin) {
+			size_t hash = parent_hash;
+
+			bool const *parent_left = left(parent_begin), *child_left = left(child_begin);
+			bool const *parent_right = right(parent_begin), *child_right = right(child_begin);
+
+			uint16_t const num_nodes_ = num_nodes(parent_begin);
+			for (auto i = 0; i < num_nodes_; ++i) {
+				if (parent_left[i] != child_left[i])
+					hash ^= particle_key(i, 0);
+
+				if (parent_right[i] != child_right[i])
+					hash ^= particle_key(i, 1);
 			}
 
-			utils::hash_combine(name_hash, left_hash);
-			utils::hash_combine(name_hash, right_hash);
-			return name_hash;
+			return hash;
 		}
 	}
 
@@ -206,18 +228,76 @@ namespace quids::rules::qcgd {
 			*(child_begin++) = graphs::sub_node(*parent_begin, graphs::dot_r_t);
 			return copy(parent_begin, parent_end, child_begin);
 		}
+
+		/// generate a range of siblings for rules flipping both particles of some nodes (erase_create and coin), decoding the parent once.
+		/**
+		 * Each node for which is_eligible(left, right) is true is either flipped (multiplying by do_, or do_conj if its left particle is present) or not (multiplying by do_not, or -do_not_conj), depending on the next bit of the child id.
+		 */
+		template<class IsEligible>
+		void inline populate_flip_children(IsEligible const &is_eligible, mag_t const &do_, mag_t const &do_not, mag_t const &do_conj, mag_t const &do_not_conj,
+			char const *parent_begin, char const *parent_end, size_t const parent_hash, char* const child_begin, uint const first_child_id, uint const num_child, uint *size, mag_t *mag, size_t *hash) {
+			uint const parent_size = std::distance(parent_begin, parent_end);
+
+			/* decode the parent once for all siblings */
+			uint16_t eligible_node[8*sizeof(uint)];
+			bool eligible_conj[8*sizeof(uint)];
+			size_t eligible_key[8*sizeof(uint)];
+			uint num_eligible = 0;
+			mag_t overflow_mag = 1;
+			bool overflow = false;
+
+			uint16_t num_nodes = graphs::num_nodes(parent_begin);
+			bool const *parent_left = graphs::left(parent_begin);
+			bool const *parent_right = graphs::right(parent_begin);
+			for (int i = 0; i < num_nodes; ++i)
+				if (is_eligible(parent_left[i], parent_right[i])) {
+					bool conj = parent_left[i];
+					if (num_eligible < 8*sizeof(uint)) {
+						eligible_node[num_eligible] = i;
+						eligible_key[num_eligible] = graphs::particle_key(i, 0) ^ graphs::particle_key(i, 1);
+						eligible_conj[num_eligible++] = conj;
+					} else {
+						/* child ids can't select more than 8*sizeof(uint) nodes */
+						overflow_mag *= conj ? -do_not_conj : do_not;
+						overflow = true;
+					}
+				}
+
+			for (uint i = 0; i < num_child; ++i) {
+				operations::copy(parent_begin, parent_end, child_begin);
+				size[i] = parent_size;
+
+				uint child_id = first_child_id + i;
+				hash[i] = parent_hash;
+
+				bool *left = graphs::left(child_begin);
+				bool *right = graphs::right(child_begin);
+				for (uint j = 0; j < num_eligible; ++j) {
+					bool conj = eligible_conj[j];
+					if (child_id & 1) {
+						mag[i] *= conj ? do_conj : do_;
+						left[eligible_node[j]] = !left[eligible_node[j]];
+						right[eligible_node[j]] = !right[eligible_node[j]];
+						hash[i] ^= eligible_key[j];
+					} else
+						mag[i] *= conj ? -do_not_conj : do_not;
+					child_id >>= 1;
+				}
+				if (overflow)
+					mag[i] *= overflow_mag;
+			}
+		}
 	}
 
 	namespace utils {
 		size_t max_print_num_graphs = -1;
 
-		void make_graph(char* &object_begin, char* &object_end, uint16_t size) {
+		size_t graph_size(uint16_t size) {
 			static auto per_node_size = 2 + sizeof(uint16_t) + sizeof(graphs::sub_node);
-			auto object_size = 2*sizeof(uint16_t) + per_node_size*size;
-
-			object_begin = new char[object_size];
-			object_end = object_begin + object_size;
+			return 2*sizeof(uint16_t) + per_node_size*size;
+		}
 
+		void make_graph(char* object_begin, uint16_t size) {
 			graphs::num_nodes(object_begin) = size;
 
 			graphs::node_name_begin(object_begin, 0) = 0;
@@ -229,9 +309,16 @@ namespace quids::rules::qcgd {
 			}
 		}
 
+		void make_graph(char* &object_begin, char* &object_end, uint16_t size) {
+			object_begin = new char[graph_size(size)];
+			object_end = object_begin + graph_size(size);
+
+			make_graph(object_begin, size);
+		}
+
 		void randomize(quids::it_t &iter) {
 			uint size;
-			mag_t *mag_;
+			quids::stored_mag_t *mag_;
 			char *begin;
 			for (auto gid = 0; gid < iter.num_object; ++gid) {;
 				iter.get_object(gid, begin, size, mag_);
@@ -314,14 +401,10 @@ namespace quids::rules::qcgd {
 				deletion_ratio = ((PROBA_TYPE)iter.num_object) / ((PROBA_TYPE)sy_it.num_object_after_interferences);
 			}
 
-			PROBA_TYPE avg_size = iter.average_value([](char const *object_begin, char const *object_end) {
+			auto const size = [](char const *object_begin, char const *object_end) {
 				return (PROBA_TYPE)graphs::num_nodes(object_begin);
-			});
-			PROBA_TYPE avg_squared_size = iter.average_value([](char const *object_begin, char const *object_end) {
-				PROBA_TYPE num_nodes = graphs::num_nodes(object_begin);
-				return num_nodes*num_nodes;
-			});
-			PROBA_TYPE avg_density = iter.average_value([](char const *object_begin, char const *object_end) {
+			};
+			auto const density = [](char const *object_begin, char const *object_end) {
 				PROBA_TYPE num_nodes = graphs::num_nodes(object_begin);
 
 				PROBA_TYPE density = 0;
@@ -330,16 +413,16 @@ namespace quids::rules::qcgd {
 				density /= 2*num_nodes;
 
 				return density;
-			});
-			PROBA_TYPE avg_squared_density = iter.average_value([](char const *object_begin, char const *object_end) {
-				PROBA_TYPE num_nodes = graphs::num_nodes(object_begin);
+			};
 
-				PROBA_TYPE density = 0;
-				for (auto i = 0; i < num_nodes; ++i)
-					density += graphs::left(object_begin, i) + graphs::right(object_begin, i);
-				density /= 2*num_nodes;
-				
-				return density*density;
+			auto const [avg_size, avg_squared_size, avg_density, avg_squared_density] = iter.average_values(size,
+			[&](char const *object_begin, char const *object_end) {
+				PROBA_TYPE this_size = size(object_begin, object_end);
+				return this_size*this_size;
+			}, density,
+			[&](char const *object_begin, char const *object_end) {
+				PROBA_TYPE this_density = density(object_begin, object_end);
+				return this_density*this_density;
 			});
 
 			PROBA_TYPE std_dev_size = avg_squared_size - avg_size*avg_size;
@@ -382,16 +465,10 @@ namespace quids::rules::qcgd {
 				deletion_ratio = (PROBA_TYPE)total_num_object / total_num_object_after_interferences;
 			}
 
-			PROBA_TYPE avg_size = iter.average_value([](char const *object_begin, char const *object_end) {
+			auto const size = [](char const *object_begin, char const *object_end) {
 				return (PROBA_TYPE)graphs::num_nodes(object_begin);
-			}, communicator);
-
-			PROBA_TYPE avg_squared_size = iter.average_value([](char const *object_begin, char const *object_end) {
-				PROBA_TYPE num_nodes = graphs::num_nodes(object_begin);
-				return num_nodes*num_nodes;
-			}, communicator);
-
-			PROBA_TYPE avg_density = iter.average_value([](char const *object_begin, char const *object_end) {
+			};
+			auto const density = [](char const *object_begin, char const *object_end) {
 				PROBA_TYPE num_nodes = graphs::num_nodes(object_begin);
 
 				PROBA_TYPE density = 0;
@@ -400,18 +477,17 @@ namespace quids::rules::qcgd {
 				density /= 2*num_nodes;
 
 				return density;
-			}, communicator);
-
-			PROBA_TYPE avg_squared_density = iter.average_value([](char const *object_begin, char const *object_end) {
-				PROBA_TYPE num_nodes = graphs::num_nodes(object_begin);
+			};
 
-				PROBA_TYPE density = 0;
-				for (auto i = 0; i < num_nodes; ++i)
-					density += graphs::left(object_begin, i) + graphs::right(object_begin, i);
-				density /= 2*num_nodes;
-				
-				return density*density;
-			}, communicator);
+			auto const [avg_size, avg_squared_size, avg_density, avg_squared_density] = iter.average_values(communicator, size,
+			[&](char const *object_begin, char const *object_end) {
+				PROBA_TYPE this_size = size(object_begin, object_end);
+				return this_size*this_size;
+			}, density,
+			[&](char const *object_begin, char const *object_end) {
+				PROBA_TYPE this_density = density(object_begin, object_end);
+				return this_density*this_density;
+			});
 
 			PROBA_TYPE std_dev_size = avg_squared_size - avg_size*avg_size;
 			std_dev_size = std_dev_size < quids::tolerance ? 0 : std::sqrt(avg_squared_size);
@@ -472,6 +548,12 @@ namespace quids::rules::qcgd {
 		inline size_t hasher(char const *parent_begin, char const *parent_end) const override {
 			return graphs::hash_graph(parent_begin);
 		}
+		inline bool has_child_hasher() const override {
+			return true;
+		}
+		inline size_t child_hasher(char const *parent_begin, char const *parent_end, size_t const parent_hash, char const *child_begin, char const *child_end, uint const child_id) const override {
+			return graphs::hash_graph_update(parent_begin, parent_hash, child_begin);
+		}
 		inline void get_num_child(char const *parent_begin, char const *parent_end, uint &num_child, uint &max_child_size) const override {
 			max_child_size = std::distance(parent_begin, parent_end);
 
@@ -508,6 +590,12 @@ namespace quids::rules::qcgd {
 				}
 			}
 		}
+		inline void populate_children(char const *parent_begin, char const *parent_end, size_t const parent_hash, char* const child_begin, uint const first_child_id, uint const num_child, uint *size, mag_t *mag, size_t *hash) const override {
+			operations::populate_flip_children([](bool const left, bool const right) {
+					return ((left + right) & 1) == 0;
+				}, do_, do_not, do_conj, do_not_conj,
+				parent_begin, parent_end, parent_hash, child_begin, first_child_id, num_child, size, mag, hash);
+		}
 		inline void populate_child_simple(char const *parent_begin, char const *parent_end, char* const child_begin, uint const child_id_) const override {
 			operations::copy(parent_begin, parent_end, child_begin);
 
@@ -547,6 +635,12 @@ namespace quids::rules::qcgd {
 		inline size_t hasher(char const *parent_begin, char const *parent_end) const override {
 			return graphs::hash_graph(parent_begin);
 		}
+		inline bool has_child_hasher() const override {
+			return true;
+		}
+		inline size_t child_hasher(char const *parent_begin, char const *parent_end, size_t const parent_hash, char const *child_begin, char const *child_end, uint const child_id) const override {
+			return graphs::hash_graph_update(parent_begin, parent_hash, child_begin);
+		}
 		inline void get_num_child(char const *parent_begin, char const *parent_end, uint &num_child, uint &max_child_size) const override {
 			max_child_size = std::distance(parent_begin, parent_end);
 
@@ -582,6 +676,12 @@ namespace quids::rules::qcgd {
 				}
 			}
 		}
+		inline void populate_children(char const *parent_begin, char const *parent_end, size_t const parent_hash, char* const child_begin, uint const first_child_id, uint const num_child, uint *size, mag_t *mag, size_t *hash) const override {
+			operations::populate_flip_children([](bool const left, bool const right) {
+					return left ^ right /* == 1 */;
+				}, do_, do_not, do_conj, do_not_conj,
+				parent_begin, parent_end, parent_hash, child_begin, first_child_id, num_child, size, mag, hash);
+		}
 		inline void populate_child_simple(char const *parent_begin, char const *parent_end, char* const child_begin, uint const child_id_) const override {
 			operations::copy(parent_begin, parent_end, child_begin);
 
@@ -1126,11 +1226,13 @@ namespace quids::rules::qcgd {
 				float real = parse_float_with_default(string_arg, "real=", ",", 1) / std::sqrt((float)n_graphs);
 				float imag = parse_float_with_default(string_arg, "imag=", ",", 0) / std::sqrt((float)n_graphs);
 
-				for (auto i = 0; i < n_graphs; ++i) {
-					char *begin, *end;
-					utils::make_graph(begin, end, n_node);
-					state.append(begin, end, {real, imag});
-				}
+				/* graphs are all inserted at once */
+				state.append(n_graphs, [&](size_t i) {
+					return utils::graph_size(n_node);
+				}, [&](size_t i, char *begin, quids::mag_t &mag) {
+					utils::make_graph(begin, n_node);
+					mag = {real, imag};
+				});
 			}
 
 			utils::randomize(state);
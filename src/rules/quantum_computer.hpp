@@ -47,6 +47,15 @@ namespace quids::rules::quantum_computer {
 
 			child_begin[bit] ^= !child_id;
 		}
+		inline size_t hasher(char const *parent_begin, char const *parent_end) const override {
+			return quids::utils::zobrist_hash(parent_begin, parent_end);
+		}
+		inline bool has_child_hasher() const override {
+			return true;
+		}
+		inline size_t child_hasher(char const *parent_begin, char const *parent_end, size_t const parent_hash, char const *child_begin, char const *child_end, uint const child_id) const override {
+			return quids::utils::zobrist_update(parent_hash, bit, parent_begin[bit], child_begin[bit]);
+		}
 	};
 
 	modifier_t inline Xgate(size_t bit) {
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 
 /// QuIDS utility function and variable namespace
 namespace quids::utils {
@@ -225,4 +228,150 @@ namespace quids::utils {
 		for (int i = 1; i < n_segment; ++i)
 			offset[i] = count[i*num_threads];
 	}
+
+	/// LSD radix sort of (key, value) pairs by key, skipping digits that are identical for all keys
+	/**
+	 * The sort is stable, and the sorted pairs are written back to [begin, end).
+	 * @param[in,out] begin,end pairs to sort.
+	 * @param[out] buffer buffer of the same size as the pairs to sort.
+	 */
+	template <class pairType>
+	void radix_sort_by_key(pairType *begin, pairType *end, pairType *buffer) {
+		static const int num_digit = sizeof(begin->first);
+		static const size_t min_radix_sort_size = 256;
+		size_t n = std::distance(begin, end);
+
+		/* histograms would cost more than sorting small inputs */
+		if (n < min_radix_sort_size) {
+			std::stable_sort(begin, end, [](pairType const &a, pairType const &b) {
+				return a.first < b.first;
+			});
+			return;
+		}
+
+		/* compute all histograms at once */
+		size_t count[num_digit*256] = {0};
+		for (size_t i = 0; i < n; ++i)
+			for (int digit = 0; digit < num_digit; ++digit)
+				++count[digit*256 + ((begin[i].first >> 8*digit) & 0xff)];
+
+		pairType *in = begin, *out = buffer;
+		for (int digit = 0; digit < num_digit; ++digit) {
+			size_t *digit_count = &count[digit*256];
+
+			/* skip digits that are the same for all keys */
+			if (digit_count[(in[0].first >> 8*digit) & 0xff] == n)
+				continue;
+
+			size_t sum = 0;
+			for (int i = 0; i < 256; ++i) {
+				size_t this_count = digit_count[i];
+				digit_count[i] = sum;
+				sum += this_count;
+			}
+
+			for (size_t i = 0; i < n; ++i)
+				out[digit_count[(in[i].first >> 8*digit) & 0xff]++] = in[i];
+
+			std::swap(in, out);
+		}
+
+		if (in != begin)
+			std::copy(in, in + n, begin);
+	}
+
+	/// parallel weighted selection: moves the elements with the smallest keys to the front, keeping as many as possible within a maximum total weight
+	/**
+	 * The cut key is found by a MSD radix select over the (float) keys, with histograms weighted by the weight of each element.
+	 * Each pass scans all elements, and there are 3 passes (for 32-bit keys) independently of the number of elements.
+	 * @param[in,out] begin,end elements to select from.
+	 * @param[in] key function returning the (float) key of an element, elements with the smallest keys are selected first.
+	 * @param[in] weight function returning the weight of an element.
+	 * @param[in] max_weight maximum total weight of the selected elements.
+	 * @return the number of selected elements (at least one if there is at least one element), which are moved to [begin, begin + return value).
+	 */
+	template <class idIteratorType, class keyFunctionType, class weightFunctionType>
+	size_t parallel_weighted_select(idIteratorType begin, idIteratorType end, keyFunctionType const key, weightFunctionType const weight, size_t max_weight) {
+		static const int num_pass = 3, bits_per_pass = 11, num_bucket = 1 << bits_per_pass;
+		size_t const n = std::distance(begin, end);
+		if (n == 0)
+			return 0;
+
+		/* map floats to unsigned integers of the same order */
+		auto const ordered_key = [&](auto const id) {
+			float this_key = key(id);
+			uint32_t bits;
+			std::memcpy(&bits, &this_key, sizeof(float));
+			return bits & 0x80000000 ? ~bits : bits | 0x80000000;
+		};
+
+		int num_threads;
+		#pragma omp parallel
+		#pragma omp single
+		num_threads = omp_get_num_threads();
+
+		std::vector<size_t> count(num_bucket*num_threads), weight_sum(num_bucket*num_threads);
+
+		/* cut key, and the total weight of elements with a smaller key */
+		uint32_t cut_key = 0, cut_mask = 0;
+		size_t selected_weight = 0;
+		for (int pass = 0; pass < num_pass; ++pass) {
+			int const num_bit = std::min(bits_per_pass, 32 - pass*bits_per_pass);
+			int const shift = 32 - pass*bits_per_pass - num_bit;
+			uint32_t const bucket_mask = (1 << num_bit) - 1;
+
+			/* weighted histogram of the elements sharing the cut key so far */
+			#pragma omp parallel
+			{
+				int thread_id = omp_get_thread_num();
+				size_t *this_count = &count[thread_id*num_bucket], *this_weight_sum = &weight_sum[thread_id*num_bucket];
+				std::fill(this_count, this_count + num_bucket, 0);
+				std::fill(this_weight_sum, this_weight_sum + num_bucket, 0);
+
+				#pragma omp for
+				for (size_t i = 0; i < n; ++i) {
+					uint32_t this_key = ordered_key(begin[i]);
+					if ((this_key & cut_mask) == cut_key) {
+						int bucket = (this_key >> shift) & bucket_mask;
+						++this_count[bucket];
+						this_weight_sum[bucket] += weight(begin[i]);
+					}
+				}
+			}
+
+			/* find the bucket in which the maximum weight is reached */
+			uint32_t cut_bucket = 0;
+			for (;; ++cut_bucket) {
+				size_t bucket_weight = 0;
+				for (int thread_id = 0; thread_id < num_threads; ++thread_id)
+					bucket_weight += weight_sum[thread_id*num_bucket + cut_bucket];
+
+				if (cut_bucket == bucket_mask || selected_weight + bucket_weight > max_weight)
+					break;
+				selected_weight += bucket_weight;
+			}
+
+			cut_key |= cut_bucket << shift;
+			cut_mask |= bucket_mask << shift;
+		}
+
+		/* elements with a smaller key than the cut key are all selected */
+		idIteratorType middle = __gnu_parallel::partition(begin, end, [&](auto const id) {
+			return ordered_key(id) < cut_key;
+		});
+		size_t num_selected = std::distance(begin, middle);
+
+		/* elements with the same key as the cut key are selected while the maximum weight isn't reached */
+		idIteratorType equal_end = __gnu_parallel::partition(middle, end, [&](auto const id) {
+			return ordered_key(id) == cut_key;
+		});
+		for (idIteratorType it = middle; it != equal_end; ++it) {
+			selected_weight += weight(*it);
+			if (selected_weight > max_weight)
+				break;
+			++num_selected;
+		}
+
+		return std::max(num_selected, (size_t)1);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "vector.hpp"
+
+/// QuIDS utility function and variable namespace
+namespace quids::utils {
+	/// persistent per-thread scratch memory.
+	/**
+	 * Each thread owns a cache-line-aligned buffer, which only grows (by at least upsize_policy), and which is (re)allocated and first touched by the thread using it,
+	 * so that it is local to its NUMA node. Buffers are kept accross calls, and the content of a buffer isn't preserved when it grows.
+	 */
+	class scratch_arena {
+	public:
+		/// alignment (in bytes) of each buffer, so that buffers of different threads never share a cache line.
+		static const size_t alignment = 64;
+
+	private:
+		/* padded to a cache line, since each thread updates its own slot */
+		struct alignas(alignment) slot_t {
+			char *ptr = NULL;
+			size_t size = 0;
+		};
+		std::vector<slot_t> slots;
+
+	public:
+		/// simple constructor
+		scratch_arena() {}
+		/// destructor, freeing all buffers
+		~scratch_arena() {
+			for (auto &slot : slots)
+				free(slot.ptr);
+		}
+		scratch_arena(scratch_arena const&) = delete;
+		scratch_arena &operator=(scratch_arena const&) = delete;
+
+		/// prepare the arena for a given number of threads (outside of a parallel region), without allocating any buffer.
+		void resize(int num_threads) {
+			if (num_threads > (int)slots.size())
+				slots.resize(num_threads);
+		}
+		/// number of threads the arena was prepared for.
+		int size() const {
+			return slots.size();
+		}
+
+		/// function returning the buffer of a thread, growing it if needed.
+		/**
+		 * Should only be called by the thread owning the buffer. The returned pointer is invalidated by a subsequent call with a larger size.
+		 * @param[in] thread_id id of the thread owning the buffer.
+		 * @param[in] size minimum size (in bytes) of the buffer.
+		 * @return pointer to the (cache-line-aligned) buffer.
+		 */
+		char *get(int thread_id, size_t size) {
+			auto &slot = slots[thread_id];
+			if (size > slot.size) {
+				free(slot.ptr);
+
+				size = ((size_t)(size*upsize_policy) + alignment - 1)/alignment*alignment;
+				if (posix_memalign((void**)&slot.ptr, alignment, size) != 0) {
+					slot.ptr = NULL;
+					slot.size = 0;
+					throw std::bad_alloc();
+				}
+				slot.size = size;
+
+				/* first touch from the owning thread */
+				std::memset(slot.ptr, 0, size);
+			}
+			return slot.ptr;
+		}
+
+		/// total memory size (in bytes) of all buffers.
+		size_t mem_size() const {
+			size_t mem_size = 0;
+			for (auto const &slot : slots)
+				mem_size += slot.size;
+			return mem_size;
+		}
+	};
+}
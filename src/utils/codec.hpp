@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// QuIDS utility function and variable namespace
+namespace quids::utils {
+	/// function returning the number of bytes of the varint (LEB128) encoding of a value.
+	inline size_t varint_size(size_t value) {
+		int num_bits = 8*sizeof(size_t) - __builtin_clzll(value | 1);
+		return (num_bits + 6)/7;
+	}
+
+	/// function writing the varint (LEB128) encoding of a value: 7 bits per byte, the highest bit marking that more bytes follow.
+	/**
+	 * @param[in] value value to encode.
+	 * @param[out] out begining of the memory to which the encoding is written (of size at least varint_size(value)).
+	 * @return end of the encoding.
+	 */
+	inline uint8_t *varint_encode(size_t value, uint8_t *out) {
+		while (value >= 0x80) {
+			*(out++) = (uint8_t)value | 0x80;
+			value >>= 7;
+		}
+		*(out++) = (uint8_t)value;
+		return out;
+	}
+
+	/// function reading a varint (LEB128) encoded value.
+	/**
+	 * @param[in] in begining of the encoding.
+	 * @param[out] value decoded value.
+	 * @return end of the encoding.
+	 */
+	inline uint8_t const *varint_decode(uint8_t const *in, size_t &value) {
+		value = 0;
+		for (int shift = 0;; shift += 7) {
+			uint8_t byte = *(in++);
+			value |= (size_t)(byte & 0x7f) << shift;
+			if (byte < 0x80)
+				return in;
+		}
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+
+#include "vector.hpp"
+
+/// QuIDS utility function and variable namespace
+namespace quids::utils {
+	/// flat open-addressing hash table used to detect collisions between (already hashed) keys.
+	/**
+	 * Keys are used directly as hashes: the lowest bits select a group of 16 slots, and 7 other bits are kept in a one byte tag per slot,
+	 * so that a whole group can be matched at once (using SSE2 if available). Groups are probed linearly.
+	 * Elements can't be erased, but the table can be reset and reused without reallocation.
+	 */
+	template<class Value=size_t>
+	class collision_table {
+	public:
+		/// type of the elements of the table
+		typedef std::pair<size_t, Value> value_type;
+
+	private:
+		static const size_t group_size = 16;
+		/* maximum load factor (in eighths) */
+		static const size_t max_load = 7;
+
+		fast_vector<uint8_t> tags;
+		fast_vector<value_type> elements;
+		size_t capacity = 0, group_mask = 0;
+
+		static inline uint8_t get_tag(size_t const key) {
+			/* the lowest bits are used to select groups, and the highest bits are shared within load-balancing buckets */
+			return 0x80 | ((key >> 32) & 0x7f);
+		}
+
+		static inline uint32_t match(uint8_t const *group, uint8_t const tag) {
+#ifdef __SSE2__
+			__m128i group_tags = _mm_loadu_si128((__m128i const*)group);
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(group_tags, _mm_set1_epi8(tag)));
+#else
+			uint32_t mask = 0;
+			for (size_t i = 0; i < group_size; ++i)
+				mask |= (uint32_t)(group[i] == tag) << i;
+			return mask;
+#endif
+		}
+
+	public:
+		/// empty the table and prepare it for a given number of insertions
+		/**
+		 * Memory is only reallocated if the table is too small, and only the part of the table needed for n insertions is cleared.
+		 * @param[in] n maximum number of insertions before the next reset.
+		 */
+		void reset(size_t n) {
+			capacity = group_size;
+			while (capacity*max_load < n*8)
+				capacity *= 2;
+			group_mask = capacity/group_size - 1;
+
+			if (tags.size() < capacity) {
+				tags.resize(capacity);
+				elements.resize(capacity);
+			}
+
+			std::memset(&tags[0], 0, capacity);
+		}
+		/// insert a (key, value) pair if the key isn't already in the table
+		/**
+		 * @param[in] element (key, value) pair to insert.
+		 * @return pointer to the element with the same key, and a bool that is true if the element was inserted.
+		 */
+		std::pair<value_type*, bool> insert(value_type const &element) {
+			uint8_t const tag = get_tag(element.first);
+
+			for (size_t group = element.first & group_mask;; group = (group + 1) & group_mask) {
+				uint8_t const *group_tags = &tags[group*group_size];
+
+				/* check all slots with a matching tag */
+				for (uint32_t mask = match(group_tags, tag); mask; mask &= mask - 1) {
+					size_t slot = group*group_size + __builtin_ctz(mask);
+					if (elements[slot].first == element.first)
+						return {&elements[slot], false};
+				}
+
+				/* elements are never erased, so the key can't be further than a group with an empty slot */
+				uint32_t empty_mask = match(group_tags, 0);
+				if (empty_mask) {
+					size_t slot = group*group_size + __builtin_ctz(empty_mask);
+					tags[slot] = tag;
+					elements[slot] = element;
+					return {&elements[slot], true};
+				}
+			}
+		}
+	};
+}
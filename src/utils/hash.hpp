@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/// QuIDS utility function and variable namespace
+namespace quids::utils {
+	/// 64-bit mixing function (splitmix64 finalizer)
+	inline size_t hash_mix(uint64_t x) {
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111eb;
+		x ^= x >> 31;
+		return x;
+	}
+
+	/// Zobrist key of a byte value at a given position.
+	/**
+	 * Zobrist hashes are the XOR of the keys of each (position, value) pair, so changing
+	 * the value at a single position only requires XOR-ing out the old key and XOR-ing in the new one.
+	 * @param[in] position position of the value (less than 2^56).
+	 * @param[in] value value at this position.
+	 */
+	inline size_t zobrist_key(size_t const position, uint8_t const value) {
+		return hash_mix(((uint64_t)position << 8) | value);
+	}
+
+	/// Zobrist hash of a memory buffer
+	/**
+	 * @param[in] begin,end delimitation of the memory buffer to hash.
+	 */
+	inline size_t zobrist_hash(char const *begin, char const *end) {
+		size_t size = end - begin;
+		size_t hash = hash_mix(~(uint64_t)size);
+		for (size_t i = 0; i < size; ++i)
+			hash ^= zobrist_key(i, begin[i]);
+		return hash;
+	}
+
+	/// update a Zobrist hash after changing a single value
+	/**
+	 * @param[in] hash hash before the change.
+	 * @param[in] position position of the changed value.
+	 * @param[in] old_value,new_value value before and after the change.
+	 */
+	inline size_t zobrist_update(size_t const hash, size_t const position, uint8_t const old_value, uint8_t const new_value) {
+		if (old_value == new_value)
+			return hash;
+		return hash ^ zobrist_key(position, old_value) ^ zobrist_key(position, new_value);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <iterator>
+
+/*
+kernels are written as "omp simd" loops over the real and imaginary parts of complex arrays (std::complex<T> is laid out as T[2]),
+so the instruction set (SSE, AVX2, AVX-512...) is selected at compile time by the target architecture (for example using "-march=native"),
+and the compiler falls back to scalar code otherwise.
+*/
+
+/// QuIDS utility function and variable namespace
+namespace quids::utils {
+	/// function computing the sum of the squared norms of an array of complex numbers
+	/**
+	 * @tparam accType type used to accumulate the sum.
+	 * @param[in] begin,end delimitations of the complex array.
+	 * @return sum of the squared norms.
+	 */
+	template<typename accType, typename T>
+	accType norm_sum(std::complex<T> const *begin, std::complex<T> const *end) {
+		T const *data = reinterpret_cast<T const*>(begin);
+		size_t const n = 2*std::distance(begin, end);
+
+		accType sum = 0;
+		#pragma omp parallel for simd reduction(+:sum)
+		for (size_t i = 0; i < n; ++i)
+			sum += (accType)data[i]*(accType)data[i];
+
+		return sum;
+	}
+
+	/// function multiplying an array of complex numbers by a real factor in place
+	/**
+	 * @tparam factorType type in which the multiplication is done (elements are converted to it, and the product is converted back).
+	 * @param[in] begin,end delimitations of the complex array.
+	 * @param[in] factor real factor.
+	 */
+	template<typename factorType, typename T>
+	void scale(std::complex<T> *begin, std::complex<T> *end, factorType const factor) {
+		T *data = reinterpret_cast<T*>(begin);
+		size_t const n = 2*std::distance(begin, end);
+
+		#pragma omp parallel for simd
+		for (size_t i = 0; i < n; ++i)
+			data[i] = (T)((factorType)data[i]*factor);
+	}
+
+	/// function computing the squared norm of each element of an array of complex numbers
+	/**
+	 * @param[in] begin,end delimitations of the complex array.
+	 * @param[out] norm begining of the output array, to which squared norms are written.
+	 */
+	template<typename T, typename normType>
+	void compute_norms(std::complex<T> const *begin, std::complex<T> const *end, normType *norm) {
+		T const *data = reinterpret_cast<T const*>(begin);
+		size_t const n = std::distance(begin, end);
+
+		#pragma omp parallel for simd
+		for (size_t i = 0; i < n; ++i)
+			norm[i] = data[2*i]*data[2*i] + data[2*i + 1]*data[2*i + 1];
+	}
+}
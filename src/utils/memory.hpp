@@ -4,6 +4,10 @@ This is the only utilisy that is operating-system dependent !
 
 #pragma once
 
+#include <sys/statvfs.h>
+
+#include "vector.hpp"
+
 /// QuIDS utility function and variable namespace
 namespace quids::utils {
 	#ifdef __CYGWIN__ // windows systems
@@ -46,4 +50,13 @@ namespace quids::utils {
 		/// function that get the total amount of available free memory.
 		size_t inline get_free_mem() { return 0; }
 	#endif
+
+	/// function that get the amount of free disk space in the directory backing file-backed vectors.
+	size_t inline get_free_disk_space() {
+		struct statvfs stat;
+		if (statvfs(mmap_directory.c_str(), &stat) != 0)
+			return 0;
+
+		return stat.f_bavail*stat.f_frsize;
+	}
 }
\ No newline at end of file
@@ -47,4 +47,20 @@ namespace quids::mpi::utils {
 	MPI_Datatype get_mpi_datatype(unsigned int x) { return MPI_UNSIGNED; }
 	MPI_Datatype get_mpi_datatype(long x) { return MPI_LONG; }
 	MPI_Datatype get_mpi_datatype(unsigned long x) { return MPI_UNSIGNED_LONG; }
+
+	/// function to get an MPI datatype corresponding to a (trivially copyable) record, sent as raw bytes
+	/**
+	 * The datatype is created and commited on the first call (which should happen after MPI_Init).
+	 * @tparam Record type of the record
+	 */
+	template<typename Record>
+	MPI_Datatype get_mpi_record_datatype() {
+		static MPI_Datatype datatype = [] {
+			MPI_Datatype datatype;
+			MPI_Type_contiguous(sizeof(Record), MPI_BYTE, &datatype);
+			MPI_Type_commit(&datatype);
+			return datatype;
+		}();
+		return datatype;
+	}
 }
\ No newline at end of file
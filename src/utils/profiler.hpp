@@ -0,0 +1,198 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <sstream>
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+/* profiling hooks, that are only compiled in the presence of the PROFILING flag:
+	- "PROFILE_OBJECTS(in, out)" accumulates the number of objects going in and out of the current phase.
+	- "PROFILE_BYTES(n)" accumulates the number of bytes touched by the current phase.
+	- "PROFILE_THREAD_BEGIN;" and "PROFILE_THREAD_END;" time the work of each thread within a parallel region of the current phase.
+*/
+#ifdef PROFILING
+	#define PROFILE_OBJECTS(in, out) do { if (quids::utils::active_profiler != NULL) quids::utils::active_profiler->add_objects(in, out); } while (0)
+	#define PROFILE_BYTES(n) do { if (quids::utils::active_profiler != NULL) quids::utils::active_profiler->add_bytes(n); } while (0)
+	#define PROFILE_THREAD_BEGIN auto profile_thread_begin = std::chrono::high_resolution_clock::now()
+	#define PROFILE_THREAD_END do { if (quids::utils::active_profiler != NULL) quids::utils::active_profiler->add_thread_time(omp_get_thread_num(), \
+		std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - profile_thread_begin).count()); } while (0)
+#else
+	#define PROFILE_OBJECTS(in, out) do {} while (0)
+	#define PROFILE_BYTES(n) do {} while (0)
+	#define PROFILE_THREAD_BEGIN do {} while (0)
+	#define PROFILE_THREAD_END do {} while (0)
+#endif
+
+/// QuIDS utility function and variable namespace
+namespace quids::utils {
+	class profiler;
+	/// profiler that last received a step, to which profiling hooks are reported.
+	profiler *active_profiler = NULL;
+
+	/// per-phase timing and counter registry, driven by the steps passed to mid_step_function
+	/**
+	 * Wall time is always recorded, while objects, bytes and per-thread imbalance are only recorded if compiled with the PROFILING flag.
+	 * A new iteration is started after each "end" step (the last step of simulate).
+	 */
+	class profiler {
+	public:
+		/// profiling data of a single phase
+		struct phase {
+			/// name of the phase (as passed to mid_step_function)
+			std::string name;
+			/// number of times the phase was entered
+			size_t num_call = 0;
+			/// wall time in seconds
+			double time = 0;
+			/// number of objects going in and out of the phase
+			size_t object_in = 0, object_out = 0;
+			/// number of bytes touched
+			size_t bytes = 0;
+			/// sum over calls of the maximum and average per-thread time, in seconds
+			double max_thread_time = 0, avg_thread_time = 0;
+		};
+
+		/// profiling data of each finished iteration
+		std::vector<std::vector<phase>> iterations;
+
+	private:
+		std::vector<phase> current_iteration;
+		int current_phase = -1;
+		std::chrono::time_point<std::chrono::high_resolution_clock> phase_begin;
+		std::vector<double> thread_time;
+
+		void close_phase() {
+			if (current_phase < 0)
+				return;
+
+			phase &this_phase = current_iteration[current_phase];
+			this_phase.time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - phase_begin).count();
+
+			/* per-thread imbalance */
+			double max_time = 0, sum_time = 0;
+			int num_threads = 0;
+			for (double &time : thread_time) {
+				if (time > 0) {
+					max_time = std::max(max_time, time);
+					sum_time += time;
+					++num_threads;
+				}
+				time = 0;
+			}
+			if (num_threads > 0) {
+				this_phase.max_thread_time += max_time;
+				this_phase.avg_thread_time += sum_time/num_threads;
+			}
+
+			current_phase = -1;
+		}
+
+	public:
+		profiler() = default;
+		profiler(profiler const&) = delete;
+		profiler(profiler&&) = delete;
+		profiler &operator=(profiler const&) = delete;
+		profiler &operator=(profiler&&) = delete;
+		~profiler() {
+			if (active_profiler == this)
+				active_profiler = NULL;
+		}
+
+		/// function marking the begining of a new phase (same signature as mid_step_function).
+		/**
+		 * @param[in] step name of the phase that starts.
+		 */
+		void operator()(const char* step) {
+			close_phase();
+			active_profiler = this;
+
+			std::string name = step;
+			if (name == "end") {
+				iterations.push_back(std::move(current_iteration));
+				current_iteration.clear();
+				return;
+			}
+
+			/* phases called multiple times in an iteration are accumulated */
+			auto it = std::find_if(current_iteration.begin(), current_iteration.end(), [&](phase const &other) {
+				return other.name == name;
+			});
+			current_phase = std::distance(current_iteration.begin(), it);
+			if (it == current_iteration.end()) {
+				current_iteration.push_back(phase());
+				current_iteration.back().name = name;
+			}
+			++current_iteration[current_phase].num_call;
+
+#ifdef _OPENMP
+			thread_time.resize(omp_get_max_threads(), 0);
+#else
+			thread_time.resize(1, 0);
+#endif
+			phase_begin = std::chrono::high_resolution_clock::now();
+		}
+		/// function returning a mid_step_function reporting to this profiler.
+		std::function<void(const char*)> mid_step_function() {
+			return [this](const char* step) {
+				(*this)(step);
+			};
+		}
+		/// function clearing all profiling data.
+		void clear() {
+			close_phase();
+			iterations.clear();
+			current_iteration.clear();
+			if (active_profiler == this)
+				active_profiler = NULL;
+		}
+
+		//! @cond
+		void add_objects(size_t in, size_t out) {
+			if (current_phase >= 0) {
+				current_iteration[current_phase].object_in += in;
+				current_iteration[current_phase].object_out += out;
+			}
+		}
+		void add_bytes(size_t n) {
+			if (current_phase >= 0)
+				current_iteration[current_phase].bytes += n;
+		}
+		void add_thread_time(int thread_id, double time) {
+			if (current_phase >= 0 && thread_id < (int)thread_time.size())
+				thread_time[thread_id] += time;
+		}
+		//! @endcond
+
+		/// function exporting the profiling data of each finished iteration as JSON.
+		std::string to_json() const {
+			std::stringstream json;
+			json << "[";
+			for (size_t i = 0; i < iterations.size(); ++i) {
+				json << (i == 0 ? "\n" : ",\n") << "\t[";
+				for (size_t j = 0; j < iterations[i].size(); ++j) {
+					phase const &this_phase = iterations[i][j];
+					double imbalance = this_phase.avg_thread_time > 0 ? this_phase.max_thread_time/this_phase.avg_thread_time : 1;
+
+					json << (j == 0 ? "\n" : ",\n") << "\t\t{"
+						<< "\"name\": \"" << this_phase.name << "\", "
+						<< "\"num_call\": " << this_phase.num_call << ", "
+						<< "\"time\": " << this_phase.time << ", "
+						<< "\"object_in\": " << this_phase.object_in << ", "
+						<< "\"object_out\": " << this_phase.object_out << ", "
+						<< "\"bytes\": " << this_phase.bytes << ", "
+						<< "\"thread_imbalance\": " << imbalance << "}";
+				}
+				json << "\n\t]";
+			}
+			json << "\n]\n";
+
+			return json.str();
+		}
+	};
+}
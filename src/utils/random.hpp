@@ -2,6 +2,8 @@
 
 #include <cstdint>
 
+#include "hash.hpp"
+
 /// QuIDS utility function and variable namespace
 namespace quids::utils {
 	/// simple random generator
@@ -25,4 +27,15 @@ namespace quids::utils {
 		    return (float)result / (float)((uint64_t)0xffffffff);
 		}
 	};
-}
\ No newline at end of file
+
+	/// counter-based random number, uniform in (0, 1]
+	/**
+	 * The generator is stateless: the same (key, counter) pair always gives the same number, independently of the thread or MPI node computing it.
+	 * @param[in] key key of the random stream (for example the hash of an object).
+	 * @param[in] counter position in the random stream.
+	 */
+	inline float counter_random(uint64_t const key, uint64_t const counter) {
+		uint64_t x = hash_mix(key ^ hash_mix(counter + 0x9e3779b97f4a7c15));
+		return ((x >> 40) + 1)*(1.f/(1 << 24));
+	}
+}
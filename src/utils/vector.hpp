@@ -6,11 +6,26 @@ typedef unsigned uint;
 #include <stdexcept>
 #include <iterator>     // std::iterator, std::input_iterator_tag
 #include <algorithm>
+#include <string>
+
+#include <sys/mman.h>
+#ifdef __linux__
+	#include <sys/syscall.h>
+	#include <linux/mempolicy.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
 
 /* default variables preprocessor definition:
 	- "UPSIZE_POLICY" corresponds to "upsize_policy" (described in iteration_t resize operators).
 	- "DOWNSIZE_POLICY" corresponds to "downsize_policy" (described in iteration_t resize operators).
 	- "MIN_VECTOR_SIZE" corresponds to "min_state_size" which is the smallest size of a vector (described in iteration_t resize operators).
+	- "MMAP_DIRECTORY" corresponds to "mmap_directory" which is the directory in which files backing file-backed vectors are created.
+	- "MREMAP_THRESHOLD" corresponds to "mremap_threshold" which is the size (in bytes) above which vectors are anonymous memory mappings (only on linux).
+	- "HUGE_PAGE_THRESHOLD" corresponds to "huge_page_threshold" which is the size (in bytes) above which vectors are backed by huge pages (0 disables huge pages).
+	- "HUGE_PAGE_SIZE" corresponds to "huge_page_size" which is the size of explicit huge pages (0 means using transparent huge pages).
+	- "NUMA_FIRST_TOUCH" sets "numa_first_touch" to true.
+	- "NUMA_INTERLEAVE" sets "numa_interleave" to true.
 */
 #ifndef UPSIZE_POLICY
 	#define UPSIZE_POLICY 1.1
@@ -21,6 +36,18 @@ typedef unsigned uint;
 #ifndef MIN_VECTOR_SIZE
 	#define MIN_VECTOR_SIZE 1000
 #endif
+#ifndef MMAP_DIRECTORY
+	#define MMAP_DIRECTORY "/tmp"
+#endif
+#ifndef MREMAP_THRESHOLD
+	#define MREMAP_THRESHOLD (1 << 21)
+#endif
+#ifndef HUGE_PAGE_THRESHOLD
+	#define HUGE_PAGE_THRESHOLD 0
+#endif
+#ifndef HUGE_PAGE_SIZE
+	#define HUGE_PAGE_SIZE 0
+#endif
 
 /// QuIDS utility function and variable namespace
 namespace quids::utils {
@@ -31,14 +58,213 @@ namespace quids::utils {
 	float downsize_policy = DOWNSIZE_POLICY;
 	/// minimum size a vector is allocated to (to avoid resizing at small sizes).
 	size_t min_vector_size = MIN_VECTOR_SIZE;
+	/// directory in which the (unlinked) files backing file-backed vectors are created.
+	std::string mmap_directory = MMAP_DIRECTORY;
+	/// size (in bytes) above which vectors are allocated as anonymous memory mappings (that are resized using mremap) rather than on the heap. Only used on linux.
+	size_t mremap_threshold = MREMAP_THRESHOLD;
+	/// size (in bytes) above which vectors are backed by huge pages (0 disables huge pages). Only used on linux.
+	size_t huge_page_threshold = HUGE_PAGE_THRESHOLD;
+	/// size (in bytes) of explicit (hugetlbfs) huge pages, like 1 << 21 or 1 << 30. 0 means using transparent huge pages (through madvise).
+	size_t huge_page_size = HUGE_PAGE_SIZE;
+	#ifdef NUMA_FIRST_TOUCH
+		/// NUMA first-touch toggle - touch pages added to a vector in parallel (with a static OpenMP schedule), so that they are placed on the NUMA node of the thread that will access them. Set true by the presence of the NUMA_FIRST_TOUCH flag.
+		bool numa_first_touch = true;
+	#else
+		/// NUMA first-touch toggle - touch pages added to a vector in parallel (with a static OpenMP schedule), so that they are placed on the NUMA node of the thread that will access them. Set false (default) by the absence of the NUMA_FIRST_TOUCH flag.
+		bool numa_first_touch = false;
+	#endif
+	#ifdef NUMA_INTERLEAVE
+		/// NUMA interleave toggle - interleave pages added to a vector accross all allowed NUMA nodes. Set true by the presence of the NUMA_INTERLEAVE flag.
+		bool numa_interleave = true;
+	#else
+		/// NUMA interleave toggle - interleave pages added to a vector accross all allowed NUMA nodes. Set false (default) by the absence of the NUMA_INTERLEAVE flag.
+		bool numa_interleave = false;
+	#endif
+
+	/// size of a memory page.
+	const size_t page_size = sysconf(_SC_PAGESIZE);
+
+	/// place the pages of a newly allocated (and not yet accessed) memory region according to numa_interleave and numa_first_touch.
+	/**
+	 * @param[in] begin,end delimitations of the memory region, only pages fully contained in the region are placed.
+	 */
+	void place_pages(char *begin, char *end) {
+		begin = (char*)(((size_t)begin + page_size - 1)/page_size*page_size);
+		if (end <= begin)
+			return;
+		size_t num_page = std::distance(begin, end)/page_size;
+		if (num_page == 0)
+			return;
+
+#ifdef __linux__
+		if (numa_interleave) {
+			/* only affects pages that weren't faulted in yet */
+			static const unsigned long max_node = 1024;
+			unsigned long nodemask[max_node/(8*sizeof(unsigned long))] = {0};
+			if (syscall(SYS_get_mempolicy, NULL, nodemask, max_node, NULL, MPOL_F_MEMS_ALLOWED) == 0)
+				syscall(SYS_mbind, begin, num_page*page_size, MPOL_INTERLEAVE, nodemask, max_node, 0);
+		}
+#endif
+
+		if (numa_first_touch)
+			#pragma omp parallel for schedule(static)
+			for (size_t page = 0; page < num_page; ++page)
+				begin[page*page_size] = 0;
+	}
 
 	/// drop-in replacement for vectors, with more "efficient" memory usage and access.
+	/**
+	 * Small buffers are allocated aligned on the heap, while buffers larger than mremap_threshold are anonymous memory mappings,
+	 * which grow and shrink in place (or by remapping pages) using mremap, so that their content is never copied.
+	 */
 	template <typename T>
 	class fast_vector/*numa_vector*/ {
 	private:
 	    mutable T* ptr = NULL;
-	    mutable T* unaligned_ptr = NULL;
 	    mutable size_t size_ = 0, capacity_ = 0;
+
+	    bool file_backed_ = false;
+	    mutable int fd = -1;
+	    mutable size_t mapped_size = 0;
+	    mutable bool huge_tlb = false;
+
+	    void release() const {
+	    	if (mapped_size > 0)
+	    		munmap(ptr, mapped_size);
+	    	else if (ptr != NULL)
+	    		free(ptr);
+	    	if (fd >= 0)
+	    		close(fd);
+
+	    	ptr = NULL;
+	    	size_ = 0;
+	    	capacity_ = 0;
+	    	fd = -1;
+	    	mapped_size = 0;
+	    	huge_tlb = false;
+	    }
+
+	    // (re)map the backing file to a given capacity, the content of the file is kept
+	    void map_file() const {
+	    	if (fd < 0) {
+	    		std::string path = mmap_directory + "/quids_XXXXXX";
+	    		fd = mkstemp(&path[0]);
+	    		if (fd < 0)
+	    			throw std::runtime_error("could not create a file to back fast_vector in \"" + mmap_directory + "\" !!");
+
+	    		// the file is removed as soon as it is closed
+	    		unlink(path.c_str());
+	    	}
+
+	    	if (ptr != NULL)
+	    		munmap(ptr, mapped_size);
+	    	mapped_size = capacity_*sizeof(T);
+
+	    	if (ftruncate(fd, mapped_size) != 0)
+	    		throw std::runtime_error("could not resize the file backing fast_vector !! size=" + std::to_string(capacity_));
+
+	    	void *mapping = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	    	if (mapping == MAP_FAILED)
+	    		throw std::runtime_error("bad memory mapping in fast_vector !! size=" + std::to_string(capacity_));
+
+	    	// mappings are page-aligned, so no manual alignment is needed
+	    	ptr = (T*)mapping;
+	    }
+
+	    // move the content of the vector to a new buffer, freeing the previous one
+	    void move_to(T *new_ptr) const {
+	    	if (ptr != NULL) {
+	    		std::copy(ptr, ptr + std::min(size_, capacity_), new_ptr);
+	    		if (mapped_size > 0)
+	    			munmap(ptr, mapped_size);
+	    		else
+	    			free(ptr);
+	    	}
+
+	    	ptr = new_ptr;
+	    }
+
+	    // change the capacity of the vector, copying its content at most once
+	    void reallocate(size_t capacity, size_t align_byte_length_) const {
+	    	capacity_ = capacity;
+
+	    	if (file_backed_) {
+	    		map_file();
+	    		return;
+	    	}
+
+#ifdef __linux__
+	    	size_t old_mapped_size = mapped_size;
+	    	size_t byte_size = std::max((size_t)1, capacity_)*sizeof(T);
+	    	bool huge = huge_page_threshold > 0 && byte_size >= huge_page_threshold;
+
+	    	// explicit huge pages, falling back to transparent huge pages if no huge page can be reserved
+	    	if (huge && huge_page_size > 0) {
+	    		size_t new_mapped_size = (byte_size + huge_page_size - 1)/huge_page_size*huge_page_size;
+	    		if (huge_tlb && new_mapped_size == mapped_size)
+	    			return;
+
+	    		void *mapping = mmap(NULL, new_mapped_size, PROT_READ | PROT_WRITE,
+	    			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (__builtin_ctzl(huge_page_size) << MAP_HUGE_SHIFT), -1, 0);
+	    		if (mapping != MAP_FAILED) {
+	    			// place pages that were added
+	    			if (numa_first_touch || numa_interleave)
+	    				place_pages((char*)mapping, (char*)mapping + new_mapped_size);
+
+	    			// hugetlb mappings can't be remapped, so the content is copied
+	    			move_to((T*)mapping);
+	    			mapped_size = new_mapped_size;
+	    			huge_tlb = true;
+	    			return;
+	    		}
+	    	}
+
+	    	if (mapped_size > 0 || byte_size >= mremap_threshold || huge) {
+	    		size_t new_mapped_size = (byte_size + page_size - 1)/page_size*page_size;
+
+	    		void *mapping;
+	    		if (mapped_size > 0 && !huge_tlb) {
+	    			// grow or shrink the mapping in place, or move its pages without copying them
+	    			mapping = mremap(ptr, mapped_size, new_mapped_size, MREMAP_MAYMOVE);
+	    		} else
+	    			mapping = mmap(NULL, new_mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	    		if (mapping == MAP_FAILED)
+	    			throw std::runtime_error("bad memory mapping in fast_vector !! size=" + std::to_string(capacity_));
+
+	    		// transparent huge pages
+	    		if (huge)
+	    			madvise(mapping, new_mapped_size, MADV_HUGEPAGE);
+
+	    		// place pages that were added
+	    		if (numa_first_touch || numa_interleave)
+	    			place_pages((char*)mapping + (huge_tlb ? 0 : old_mapped_size), (char*)mapping + new_mapped_size);
+
+	    		// switching from the heap (or from explicit huge pages) to a mapping
+	    		if ((mapped_size == 0 || huge_tlb) && ptr != NULL)
+	    			move_to((T*)mapping);
+
+	    		ptr = (T*)mapping;
+	    		mapped_size = new_mapped_size;
+	    		huge_tlb = false;
+	    	} else
+#endif
+	    	{
+	    		// small vectors (and all vectors on systems other than linux, that lack mremap) are allocated on the heap, and their content is copied
+	    		size_t alignment = std::max(sizeof(void*), (size_t)align_byte_length_);
+	    		alignment = (size_t)1 << (8*sizeof(size_t) - __builtin_clzl(alignment - 1)); // round up to a power of two
+
+	    		T *new_ptr;
+	    		if (posix_memalign((void**)&new_ptr, alignment, std::max((size_t)1, capacity_)*sizeof(T)) != 0)
+	    			throw std::runtime_error("bad allocation in fast_vector !! size=" + std::to_string(capacity_) + ", alignment=" + std::to_string(alignment));
+
+	    		// place pages that were added
+	    		if (numa_first_touch || numa_interleave)
+	    			place_pages((char*)new_ptr, (char*)(new_ptr + capacity_));
+
+	    		move_to(new_ptr);
+	    	}
+	    }
 	 
 	public:
 		template<typename Int=size_t>
@@ -47,12 +273,38 @@ namespace quids::utils {
 		}
 
 		~fast_vector() {
-			if (ptr != NULL) {
-				free(ptr);
-				ptr = NULL;
-				size_ = 0;
-				capacity_ = 0;
-			}
+			release();
+		}
+
+		/// switch between heap memory and memory mapped from a file in mmap_directory (the content of the vector is kept).
+		void set_file_backed(bool file_backed=true) {
+			if (file_backed == file_backed_)
+				return;
+
+			fast_vector<T> other;
+			other.release();
+			other.file_backed_ = file_backed;
+			other.resize(size_);
+			std::copy(begin(), end(), other.begin());
+
+			std::swap(ptr, other.ptr);
+			std::swap(size_, other.size_);
+			std::swap(capacity_, other.capacity_);
+			std::swap(file_backed_, other.file_backed_);
+			std::swap(fd, other.fd);
+			std::swap(mapped_size, other.mapped_size);
+			std::swap(huge_tlb, other.huge_tlb);
+		}
+
+		/// wether the vector is backed by a memory-mapped file.
+		bool is_file_backed() const {
+			return file_backed_;
+		}
+
+		/// give a hint about the upcoming access pattern (like MADV_SEQUENTIAL) to the kernel, only applies to file-backed vectors.
+		void advise(int advice) const {
+			if (fd >= 0 && ptr != NULL)
+				madvise(ptr, mapped_size, advice);
 		}
 	 
 	    // NOT SUPPORTED !!!
@@ -107,45 +359,36 @@ namespace quids::utils {
 			(to allow memory to be freed and given back to another vector).
 		"min_state_size" is the minimum size of a vector, to avoid small vectors which are bound to be resized frequently.
 		*/
-		/// align_byte_length_ should be used to reallign the buffer, which is not yet implemented as realloc doesn't allocate.
+		/// align_byte_length_ is the alignment (in bytes) of the buffer, memory mappings being always page-aligned.
 		template<typename Int=size_t>
 	    void resize(const Int n, const uint align_byte_length_=std::alignment_of<T>()) const {
 	    	size_t capped_size = std::max(min_vector_size, (size_t)n); // never resize under min_vector_size
 
 	    	if (capacity_ < capped_size || // resize if we absolutely have to because the state won't fit
-	    		capped_size*upsize_policy < capacity_*downsize_policy) { // resize if the size we resize to is small enough (to free memory)
-	    		// for later allignment
-	    		size_t old_size_ = size_;
-
-	    		size_     = n;
-	    		capacity_ = capped_size*upsize_policy;
-
-	    		int offset = std::distance(unaligned_ptr, ptr);
-	    		unaligned_ptr = (T*)realloc(unaligned_ptr, (capacity_ + align_byte_length_)*sizeof(T));
-
-	    		if (unaligned_ptr == NULL)
-	    			throw std::runtime_error("bad allocation in fast_vector !! size=" + std::to_string(capacity_) + "+" + std::to_string(align_byte_length_) + ", offset=" + std::to_string(offset));
-
-	    		ptr = unaligned_ptr + offset;
-	    		if (align_byte_length_ > 1) {
-	    			// manual allignment:
-	    			size_t allign_offset = ((size_t)ptr)%align_byte_length_;
-
-	    			if (allign_offset != 0)
-		    			// allign by rotating to the left:
-		    			if (allign_offset <= offset) {
-		    				std::rotate<char*>(((char*)ptr) - allign_offset, (char*)ptr, ((char*)ptr) + old_size_*sizeof(T));
-		    				ptr -= allign_offset;
-		    			} else {
-		    				// allign by rotating to the right
-		    				allign_offset = align_byte_length_ - allign_offset;
-		    				std::rotate<char*>((char*)ptr, ((char*)ptr) + old_size_*sizeof(T), ((char*)ptr) + old_size_*sizeof(T) + allign_offset);
-		    				ptr += allign_offset;
-		    			}
-	    		}
-	    	} else {
-	    		size_ = n;
-	    	}
+	    		capped_size*upsize_policy < capacity_*downsize_policy || // resize if the size we resize to is small enough (to free memory)
+	    		(align_byte_length_ > 1 && ((size_t)ptr)%align_byte_length_ != 0)) // resize if the buffer isn't aligned
+	    		reallocate(capped_size*upsize_policy, align_byte_length_);
+
+	    	size_ = n;
+	    }
+
+		/// make sure the vector can hold at least n elements without reallocating (its size is unchanged).
+		template<typename Int=size_t>
+	    void reserve(const Int n, const uint align_byte_length_=std::alignment_of<T>()) const {
+	    	if (capacity_ < (size_t)n)
+	    		reallocate(n, align_byte_length_);
+	    }
+
+		/// free the memory that isn't used by the elements of the vector (never under min_vector_size).
+	    void shrink_to_fit(const uint align_byte_length_=std::alignment_of<T>()) const {
+	    	size_t capped_size = std::max(min_vector_size, size_);
+	    	if (capped_size < capacity_)
+	    		reallocate(capped_size, align_byte_length_);
+	    }
+
+	    /// number of elements the vector can hold without reallocating.
+	    size_t capacity() const {
+	    	return capacity_;
 	    }
 	 
 	    // Begin iterator